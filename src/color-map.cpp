@@ -8,6 +8,8 @@
 
 #include <cmath>
 #include <cassert>
+#include <cstring>
+#include <limits>
 
 std::unique_ptr<ColorMap>
 ColorMap::Build(ColorMapType type, const sf::Color& bg_color, const sf::Color& custom_color)
@@ -52,6 +54,14 @@ ColorMap::Build(ColorMapType type, const sf::Color& bg_color, const sf::Color& c
     }
 }
 
+std::vector<uint8_t>
+ColorMap::Map(const RealWindow& input) const
+{
+    std::vector<uint8_t> output(input.size() * 4);
+    this->Map(input, output);
+    return output;
+}
+
 std::vector<uint8_t>
 ColorMap::Gradient(std::size_t width) const
 {
@@ -63,8 +73,9 @@ ColorMap::Gradient(std::size_t width) const
     return this->Map(values);
 }
 
-InterpolationColorMap::InterpolationColorMap(const std::vector<sf::Color>& colors,
-                                             const std::vector<double>& vals) : colors_(colors), values_(vals)
+InterpolationColorMap::InterpolationColorMap(const std::vector<sf::Color>& colors, const std::vector<double>& vals,
+                                             std::size_t lut_resolution)
+    : colors_(colors), values_(vals), lut_resolution_(lut_resolution)
 {
     /* respect boundaries */
     if (vals.size() != colors.size()) {
@@ -84,10 +95,19 @@ InterpolationColorMap::InterpolationColorMap(const std::vector<sf::Color>& color
             throw std::runtime_error("boundaries must be ascending");
         }
     }
+    if (lut_resolution == 0) {
+        throw std::runtime_error("colormap lookup table resolution must be positive");
+    }
+
+    /* interpolate lookup table */
+    this->lut_.resize((lut_resolution + 1) * 4);
+    for (std::size_t i = 0; i <= lut_resolution; i++) {
+        this->GetColor((double)i / (double)lut_resolution, this->lut_.data() + i * 4);
+    }
 }
 
-std::vector<uint8_t>
-InterpolationColorMap::GetColor(double value) const
+void
+InterpolationColorMap::GetColor(double value, uint8_t *rgba) const
 {
     if ((value < 0.0f) || (value > 1.0f)) {
         throw std::runtime_error("input value outside of colormap domain");
@@ -102,35 +122,51 @@ InterpolationColorMap::GetColor(double value) const
     double fu = (value - this->values_[k]) / (this->values_[k+1] - this->values_[k]);
     double fl = 1.0f - fu;
 
-    return {
-        static_cast<uint8_t>(std::round(fl * this->colors_[k].r + fu * this->colors_[k+1].r)),
-        static_cast<uint8_t>(std::round(fl * this->colors_[k].g + fu * this->colors_[k+1].g)),
-        static_cast<uint8_t>(std::round(fl * this->colors_[k].b + fu * this->colors_[k+1].b)),
-        static_cast<uint8_t>(std::round(fl * this->colors_[k].a + fu * this->colors_[k+1].a)),
-    };
+    rgba[0] = static_cast<uint8_t>(std::round(fl * this->colors_[k].r + fu * this->colors_[k+1].r));
+    rgba[1] = static_cast<uint8_t>(std::round(fl * this->colors_[k].g + fu * this->colors_[k+1].g));
+    rgba[2] = static_cast<uint8_t>(std::round(fl * this->colors_[k].b + fu * this->colors_[k+1].b));
+    rgba[3] = static_cast<uint8_t>(std::round(fl * this->colors_[k].a + fu * this->colors_[k+1].a));
 }
 
-std::vector<uint8_t>
-InterpolationColorMap::Map(const RealWindow& input) const
+void
+InterpolationColorMap::Map(std::span<const double> input, std::span<uint8_t> output) const
 {
-    std::vector<uint8_t> output;
-    output.resize(input.size() * 4);
+    if (output.size() != input.size() * 4) {
+        throw std::runtime_error("output size must be four times the input size");
+    }
 
+    const double scale = (double)this->lut_resolution_;
     for (std::size_t i = 0; i < input.size(); i++) {
-        auto color = this->GetColor(input[i]);
-        assert(color.size() == 4);
-        output[i * 4 + 0] = color[0];
-        output[i * 4 + 1] = color[1];
-        output[i * 4 + 2] = color[2];
-        output[i * 4 + 3] = color[3];
+        double value = input[i];
+        if ((value < 0.0f) || (value > 1.0f)) {
+            throw std::runtime_error("input value outside of colormap domain");
+        }
+
+        /* nearest entry; NaN maps to the first one */
+        std::size_t k = std::isnan(value) ? 0 : static_cast<std::size_t>(value * scale + 0.5);
+        std::memcpy(output.data() + i * 4, this->lut_.data() + k * 4, 4);
     }
+}
 
-    return output;
+void
+InterpolationColorMap::Map(std::span<const uint16_t> input, std::span<uint8_t> output) const
+{
+    if (output.size() != input.size() * 4) {
+        throw std::runtime_error("output size must be four times the input size");
+    }
+
+    /* nearest entry, in integer arithmetic */
+    constexpr uint64_t max = std::numeric_limits<uint16_t>::max();
+    const uint64_t resolution = this->lut_resolution_;
+    for (std::size_t i = 0; i < input.size(); i++) {
+        std::size_t k = (input[i] * resolution + max / 2) / max;
+        std::memcpy(output.data() + i * 4, this->lut_.data() + k * 4, 4);
+    }
 }
 
 std::unique_ptr<ColorMap> InterpolationColorMap::Copy() const
 {
-    return std::make_unique<InterpolationColorMap>(colors_, values_);
+    return std::make_unique<InterpolationColorMap>(colors_, values_, lut_resolution_);
 }
 
 TwoColorMap::TwoColorMap(const sf::Color& c1, const sf::Color& c2)
@@ -66,7 +66,26 @@ public:
      * @param input Array of floating point values in the domain [0..1].
      * @return Array of bytes, 4 for each input value, RGBA format.
      */
-    virtual std::vector<uint8_t> Map(const RealWindow& input) const = 0;
+    std::vector<uint8_t> Map(const RealWindow& input) const;
+
+    /**
+     * Map a window of real values to RGBA colours, into a caller provided
+     * buffer.
+     * @param input Array of floating point values in the domain [0..1].
+     * @param output Buffer that receives 4 bytes for each input value, RGBA
+     *               format; must have exactly 4 * input.size() bytes.
+     */
+    virtual void Map(std::span<const double> input, std::span<uint8_t> output) const = 0;
+
+    /**
+     * Map a window of quantized values to RGBA colours, into a caller provided
+     * buffer.
+     * @param input Array of values, 0 standing for 0.0 and the maximum value
+     *              of uint16_t for 1.0 (see History).
+     * @param output Buffer that receives 4 bytes for each input value, RGBA
+     *               format; must have exactly 4 * input.size() bytes.
+     */
+    virtual void Map(std::span<const uint16_t> input, std::span<uint8_t> output) const = 0;
 
     /**
      * Create a gradient of the colormap, displaying all possible colors.
@@ -84,27 +103,42 @@ public:
 /**
  * Color map that linearly interpolates between a number of specified colors,
  * based on value landmarks.
+ *
+ * Colors are interpolated once, at construction, into a lookup table that
+ * evenly samples the [0..1] domain; mapping a value picks the nearest entry.
  */
 class InterpolationColorMap : public ColorMap {
 private:
     const std::vector<sf::Color> colors_;
     const std::vector<double> values_;
+    const std::size_t lut_resolution_;  /* number of steps between lookup table entries 0.0 and 1.0 */
+    std::vector<uint8_t> lut_;          /* RGBA colors, for lut_resolution_ + 1 evenly spaced values */
 
-    std::vector<uint8_t> GetColor(double value) const;
+    void GetColor(double value, uint8_t *rgba) const;
 
 public:
+    /* default lookup table resolution; a power of two, so that landmarks such as 0.5 or 0.25 are exact */
+    static constexpr std::size_t DEFAULT_LUT_RESOLUTION = 4096;
+
     /**
      * Create an interpolation-based colormap.
      * @param colors Vectors of colors used for interpolation.
      * @param vals The corresponding value for each color.
+     * @param lut_resolution Number of steps in which the [0..1] domain is
+     *                       sampled by the lookup table.
      *
      * NOTE: First value in "vals" must be 0.0 and last value must be "1.0".
      *       Thus, the whole [0..1] domain is covered.
      */
-    InterpolationColorMap(const std::vector<sf::Color>& colors, const std::vector<double>& vals);
+    InterpolationColorMap(const std::vector<sf::Color>& colors, const std::vector<double>& vals,
+                          std::size_t lut_resolution = DEFAULT_LUT_RESOLUTION);
     InterpolationColorMap() = delete;
 
-    std::vector<uint8_t> Map(const std::vector<double>& input) const override;
+    auto GetLUTResolution() const { return lut_resolution_; }
+
+    using ColorMap::Map;
+    void Map(std::span<const double> input, std::span<uint8_t> output) const override;
+    void Map(std::span<const uint16_t> input, std::span<uint8_t> output) const override;
     std::unique_ptr<ColorMap> Copy() const override;
 };
 
@@ -10,6 +10,7 @@
 #include "input-parser.hpp"
 #include "specgram.hpp"
 #include "fft.hpp"
+#include "png-writer.hpp"
 
 #include <tuple>
 #include <regex>
@@ -27,15 +28,21 @@ Configuration::Configuration()
     this->has_complex_input_ = false;
     this->prescale_factor_ = 1.0f;
     this->sleep_for_input_ = 0;
+    this->queue_depth_ = 64;
 
     this->fft_width_ = 1024;
     this->fft_stride_ = 1024;
     this->alias_negative_ = true;
     this->window_function_ = WindowFunctionType::kHann;
     this->average_count_ = 1;
+    this->precision_ = Precision::kDouble;
+    this->fft_planner_ = FFTPlanner::kEstimate;
+    this->thread_count_ = 1;
 
     this->no_resampling_ = false;
     this->width_ = 512;
+    this->freq_reduction_ = FrequencyReduction::kLanczos;
+    this->png_compression_ = PngWriter::DEFAULT_COMPRESSION_LEVEL;
     this->min_freq_ = 0;
     this->max_freq_ = this->rate_ / 2;
     this->scale_type_ = ValueMapType::kDecibel;
@@ -55,6 +62,7 @@ Configuration::Configuration()
     this->live_ = false;
     this->count_ = 512;
     this->title_ = "Spectrogram";
+    this->frame_rate_ = 60;
 
 
     this->has_live_window_ = false;
@@ -172,6 +180,8 @@ Configuration::Build(int argc, const char **argv)
         block_size(input_opts, "integer", "Block size when reading input, in data types (default: 256)", {'b', "block_size"});
     args::ValueFlag<int>
         sleep_for_input(input_opts, "integer", "Duration in milliseconds to sleep for when input is not available (default: 0, busywaits)", {'S', "sleep_for_input"});
+    args::ValueFlag<int>
+        queue_depth(input_opts, "integer", "Number of blocks buffered when reading from stdin (default: 64)", {"queue_depth"});
 
     args::Group fft_opts(parser, "FFT options:", args::Group::Validators::DontCare);
     args::ValueFlag<int>
@@ -185,6 +195,13 @@ Configuration::Build(int argc, const char **argv)
               {'m', "alias"});
     args::ValueFlag<int>
         average(fft_opts, "integer", "Number of windows to average (default: 1)", {'A', "average"});
+    args::ValueFlag<std::string>
+        precision(fft_opts, "string", "Precision of signal processing, float or double (default: double)", {"precision"});
+    args::ValueFlag<std::string>
+        fft_planner(fft_opts, "string", "FFTW planner rigor, estimate, measure, patient or exhaustive (default: estimate)",
+                    {"fft_planner"});
+    args::ValueFlag<int>
+        threads(fft_opts, "integer", "Number of threads processing file input (default: 1)", {"threads"});
 
     args::Group display_opts(parser, "Display options:", args::Group::Validators::DontCare);
     args::Flag
@@ -192,6 +209,9 @@ Configuration::Build(int argc, const char **argv)
                       {'q', "no_resampling"});
     args::ValueFlag<int>
         width(display_opts, "integer", "Display width (default: 512)", {'w', "width"});
+    args::ValueFlag<std::string>
+        freq_reduce(display_opts, "string", "Reduction of FFT bins to display width, lanczos, max or mean (default: lanczos)",
+                    {"freq_reduce"});
     args::ValueFlag<float>
         fmin(display_opts, "float", "Minimum frequency in Hz (default: -0.5 * rate for complex data types, 0 otherwise)", {'x', "fmin"});
     args::ValueFlag<float>
@@ -210,6 +230,9 @@ Configuration::Build(int argc, const char **argv)
         legend(display_opts, "legend", "Display legend", {'e', "legend"});
     args::Flag
         horizontal(display_opts, "horizontal", "Display horizontally", {'z', "horizontal"});
+    args::ValueFlag<int>
+        png_compression(display_opts, "integer", "PNG compression level, 0 (fastest) to 9 (smallest) (default: 6)",
+                        {"png_compression"});
     args::Flag
         print_input(display_opts, "print_input", "Print input window", {"print_input"});
     args::Flag
@@ -224,6 +247,8 @@ Configuration::Build(int argc, const char **argv)
         count(live_opts, "integer", "Number of FFT windows in displayed history (default: 512)", {'k', "count"});
     args::ValueFlag<std::string>
         title(live_opts, "string", "Window title", {'t', "title"});
+    args::ValueFlag<int>
+        frame_rate(live_opts, "integer", "Frames per second in live window (default: 60)", {"frame_rate"});
 
     /* parse arguments */
     try {
@@ -280,6 +305,14 @@ Configuration::Build(int argc, const char **argv)
             conf.sleep_for_input_ = args::get(sleep_for_input);
         }
     }
+    if (queue_depth) {
+        if (args::get(queue_depth) <= 0) {
+            std::cerr << "'queue_depth' must be positive." << std::endl;
+            return std::make_tuple(conf, 1, true);
+        } else {
+            conf.queue_depth_ = args::get(queue_depth);
+        }
+    }
     if (rate) {
         if (args::get(rate) <= 0) {
             std::cerr << "'rate' must be positive." << std::endl;
@@ -370,6 +403,40 @@ Configuration::Build(int argc, const char **argv)
             return std::make_tuple(conf, 1, true);
         }
     }
+    if (precision) {
+        auto& prec_str = args::get(precision);
+        if (prec_str == "float") {
+            conf.precision_ = Precision::kSingle;
+        } else if (prec_str == "double") {
+            conf.precision_ = Precision::kDouble;
+        } else {
+            std::cerr << "Unknown precision '" << prec_str << "'" << std::endl;
+            return std::make_tuple(conf, 1, true);
+        }
+    }
+    if (fft_planner) {
+        auto& planner_str = args::get(fft_planner);
+        if (planner_str == "estimate") {
+            conf.fft_planner_ = FFTPlanner::kEstimate;
+        } else if (planner_str == "measure") {
+            conf.fft_planner_ = FFTPlanner::kMeasure;
+        } else if (planner_str == "patient") {
+            conf.fft_planner_ = FFTPlanner::kPatient;
+        } else if (planner_str == "exhaustive") {
+            conf.fft_planner_ = FFTPlanner::kExhaustive;
+        } else {
+            std::cerr << "Unknown FFT planner '" << planner_str << "'" << std::endl;
+            return std::make_tuple(conf, 1, true);
+        }
+    }
+    if (threads) {
+        if (args::get(threads) <= 0) {
+            std::cerr << "'threads' must be positive." << std::endl;
+            return std::make_tuple(conf, 1, true);
+        } else {
+            conf.thread_count_ = args::get(threads);
+        }
+    }
     if (alias) {
         conf.alias_negative_ = args::get(alias);
     }
@@ -394,6 +461,22 @@ Configuration::Build(int argc, const char **argv)
             conf.width_ = args::get(width);
         }
     }
+    if (freq_reduce) {
+        auto& reduce_str = args::get(freq_reduce);
+        if (conf.no_resampling_) {
+            std::cerr << "'freq_reduce' cannot be specified when not resampling (-q, --no_resampling)." << std::endl;
+            return std::make_tuple(conf, 1, true);
+        } else if (reduce_str == "lanczos") {
+            conf.freq_reduction_ = FrequencyReduction::kLanczos;
+        } else if (reduce_str == "max") {
+            conf.freq_reduction_ = FrequencyReduction::kMax;
+        } else if (reduce_str == "mean") {
+            conf.freq_reduction_ = FrequencyReduction::kMean;
+        } else {
+            std::cerr << "Unknown frequency reduction '" << reduce_str << "'" << std::endl;
+            return std::make_tuple(conf, 1, true);
+        }
+    }
     if (fmin) {
         conf.min_freq_ = args::get(fmin);
     }
@@ -494,6 +577,14 @@ Configuration::Build(int argc, const char **argv)
     if (horizontal) {
         conf.is_horizontal_ = true;
     }
+    if (png_compression) {
+        if (args::get(png_compression) < 0 || args::get(png_compression) > 9) {
+            std::cerr << "'png_compression' must be between 0 and 9." << std::endl;
+            return std::make_tuple(conf, 1, true);
+        } else {
+            conf.png_compression_ = args::get(png_compression);
+        }
+    }
     if (print_input) {
         conf.print_input_ = true;
     }
@@ -522,6 +613,14 @@ Configuration::Build(int argc, const char **argv)
     if (title) {
         conf.title_ = args::get(title);
     }
+    if (frame_rate) {
+        if (args::get(frame_rate) <= 0) {
+            std::cerr << "'frame_rate' must be positive." << std::endl;
+            return std::make_tuple(conf, 1, true);
+        } else {
+            conf.frame_rate_ = args::get(frame_rate);
+        }
+    }
 
     /* compute width for --no_resampling case */
     if (conf.no_resampling_) {
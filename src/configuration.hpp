@@ -9,6 +9,7 @@
 #define _CONFIGURATION_HPP_
 
 #include "color-map.hpp"
+#include "fft.hpp"
 #include "value-map.hpp"
 #include "window-function.hpp"
 
@@ -33,15 +34,20 @@ private:
     bool has_complex_input_;                /* true if input is complex */
     double prescale_factor_;                /* value to scale input with before applying other transformations */
     std::size_t sleep_for_input_;           /* number of milliseconds to sleep when input is not ready */
+    std::size_t queue_depth_;               /* number of blocks buffered from stdin */
 
     std::size_t fft_width_;                 /* size of FFT window, in values */
     std::size_t fft_stride_;                /* stride of FFT window, in values */
     WindowFunctionType window_function_;    /* window function to apply before FFT */
     std::size_t average_count_;             /* number of windows to average for each displayed window */
     bool alias_negative_;                   /* alias negative frequencies to positive */
+    Precision precision_;                   /* precision of the signal processing pipeline */
+    FFTPlanner fft_planner_;                /* rigor of FFTW planning */
+    std::size_t thread_count_;              /* number of threads processing file input */
 
     bool no_resampling_;                    /* do not perform resampling; if true, width_ is meaningless */
     std::size_t width_;                     /* width of resampled output window, in values or pixels */
+    FrequencyReduction freq_reduction_;     /* method of resampling FFT bins to width_ */
     double min_freq_;                       /* lower bound of displayed frewquency band */
     double max_freq_;                       /* upper bound of displayed frewquency band */
     ValueMapType scale_type_;               /* type of scale used on FFT output */
@@ -55,6 +61,7 @@ private:
     bool has_axes_;                         /* render axes */
     bool has_legend_;                       /* render legend */
     bool is_horizontal_;                    /* flows from left to right, instead of top to bottom */
+    int png_compression_;                   /* compression level of PNG output, 0 to 9 */
     bool print_input_;                      /* debug printing of input */
     bool print_fft_;                        /* debug printing of FFT values */
     bool print_output_;                     /* debug printing of output */
@@ -62,6 +69,7 @@ private:
     bool live_;                             /* whether we have live output or not */
     std::size_t count_;                     /* number of output windows to display in spectrogoram */
     std::string title_;                     /* window title */
+    std::size_t frame_rate_;                /* live window frames per second */
 
     bool has_live_window_;                  /* display a live plot of the current FFT window */
 
@@ -112,6 +120,7 @@ public:
     auto HasComplexInput() const { return has_complex_input_; }
     auto GetPrescaleFactor() const { return prescale_factor_; }
     auto GetSleepForInput() const { return sleep_for_input_; }
+    auto GetQueueDepth() const { return queue_depth_; }
 
     /* FFT getters */
     auto GetFFTWidth() const { return fft_width_; }
@@ -119,10 +128,14 @@ public:
     auto GetWindowFunction() const { return window_function_; }
     auto IsAliasingNegativeFrequencies() const { return alias_negative_; }
     auto GetAverageCount() const { return average_count_; }
+    auto GetPrecision() const { return precision_; }
+    auto GetFFTPlanner() const { return fft_planner_; }
+    auto GetThreadCount() const { return thread_count_; }
 
     /* display getters */
     auto CanResample() const { return !no_resampling_; }
     auto GetWidth() const { return width_; }
+    auto GetFrequencyReduction() const { return freq_reduction_; }
     auto GetMinFreq() const { return min_freq_; }
     auto GetMaxFreq() const { return max_freq_; }
     auto GetScaleType() const { return scale_type_; }
@@ -136,6 +149,7 @@ public:
     auto HasAxes() const { return has_axes_ || has_legend_; }
     auto HasLegend() const { return has_legend_; }
     auto IsHorizontal() const { return is_horizontal_; }
+    auto GetPNGCompression() const { return png_compression_; }
     auto MustPrintInput() const { return print_input_; }
     auto MustPrintFFT() const { return print_fft_; }
     auto MustPrintOutput() const { return print_output_; }
@@ -144,6 +158,7 @@ public:
     auto IsLive() const { return live_; }
     auto GetCount() const { return count_; }
     auto GetTitle() const { return title_; }
+    auto GetFrameRate() const { return frame_rate_; }
 
     /* internal options */
     auto HasLiveWindow() const { return has_live_window_; }
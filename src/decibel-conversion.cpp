@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "decibel-conversion.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPECGRAM_X86_KERNELS
+#endif
+
+/*
+ * log2(x) is computed as e + log2(m), with x = m * 2^e and m in [sqrt(0.5), sqrt(2)). For t = (m - 1) / (m + 1),
+ * log2(m) = 2 / ln(2) * atanh(t) = 2 / ln(2) * (t + t^3/3 + t^5/5 + t^7/7 + ...); since |t| < 0.172, the series is
+ * truncated after t^7, with an error below 1e-7.
+ *
+ * All kernels perform the exact same single precision operations, in the same order, so their results are identical.
+ */
+static constexpr float kLog2C1 = 2.8853900817779268f;   /* 2 / (1 ln(2)) */
+static constexpr float kLog2C3 = 0.9617966939259757f;   /* 2 / (3 ln(2)) */
+static constexpr float kLog2C5 = 0.5770780163555853f;   /* 2 / (5 ln(2)) */
+static constexpr float kLog2C7 = 0.41219858311113244f;  /* 2 / (7 ln(2)) */
+static constexpr float kSqrt2 = 1.4142135623730951f;
+static constexpr double kDecibelsPerOctave = 3.010299956639812; /* 10 log10(2) */
+
+/**
+ * Scalar kernel; also used for the tails of the vector kernels.
+ * @param in Complex values, as interleaved real and imaginary parts.
+ * @param begin Index of first value to map.
+ * @param end Index past the last value to map.
+ * @param a Factor applied to log2 of power.
+ * @param b Offset added after scaling.
+ * @param out Normalized levels.
+ */
+template <class P>
+static void
+map_scalar(const P *in, std::size_t begin, std::size_t end, float a, float b, P *out)
+{
+    for (std::size_t i = begin; i < end; i++) {
+        P power = in[2 * i] * in[2 * i] + in[2 * i + 1] * in[2 * i + 1];
+
+        /* limit to normal single precision values; NaN fails the first comparison */
+        power = (power > std::numeric_limits<float>::min()) ? power : std::numeric_limits<float>::min();
+        power = (power < std::numeric_limits<float>::max()) ? power : std::numeric_limits<float>::max();
+
+        /* split into exponent and mantissa */
+        auto bits = std::bit_cast<std::int32_t>(static_cast<float>(power));
+        std::int32_t e = (bits >> 23) - 127;
+        float m = std::bit_cast<float>((bits & 0x007fffff) | 0x3f800000);
+        if (m > kSqrt2) {
+            m = m * 0.5f;
+            e = e + 1;
+        }
+
+        float t = (m - 1.0f) / (m + 1.0f);
+        float t2 = t * t;
+        float poly = kLog2C1 + t2 * (kLog2C3 + t2 * (kLog2C5 + t2 * kLog2C7));
+        float log2 = static_cast<float>(e) + t * poly;
+
+        float value = log2 * a + b;
+        value = (value > 0.0f) ? value : 0.0f;
+        value = (value < 1.0f) ? value : 1.0f;
+        out[i] = static_cast<P>(value);
+    }
+}
+
+#ifdef SPECGRAM_X86_KERNELS
+
+/**
+ * Computes normalized levels from four powers, using SSE2.
+ */
+static inline __m128
+levels4_sse2(__m128 power, __m128 a, __m128 b)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    power = _mm_max_ps(power, _mm_set1_ps(std::numeric_limits<float>::min()));
+    power = _mm_min_ps(power, _mm_set1_ps(std::numeric_limits<float>::max()));
+
+    __m128i bits = _mm_castps_si128(power);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                             _mm_set1_epi32(0x3f800000)));
+    __m128 above = _mm_cmpgt_ps(m, _mm_set1_ps(kSqrt2));
+    m = _mm_or_ps(_mm_and_ps(above, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(above, m));
+    e = _mm_sub_epi32(e, _mm_castps_si128(above)); /* mask is -1 */
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+    __m128 t2 = _mm_mul_ps(t, t);
+    __m128 poly = _mm_add_ps(_mm_set1_ps(kLog2C5), _mm_mul_ps(t2, _mm_set1_ps(kLog2C7)));
+    poly = _mm_add_ps(_mm_set1_ps(kLog2C3), _mm_mul_ps(t2, poly));
+    poly = _mm_add_ps(_mm_set1_ps(kLog2C1), _mm_mul_ps(t2, poly));
+    __m128 log2 = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(t, poly));
+
+    __m128 value = _mm_add_ps(_mm_mul_ps(log2, a), b);
+    value = _mm_max_ps(value, _mm_setzero_ps());
+    return _mm_min_ps(value, one);
+}
+
+/**
+ * Computes the powers of four complex values, using SSE2.
+ */
+static inline __m128
+power4_sse2(const float *p)
+{
+    __m128 x0 = _mm_loadu_ps(p);        /* r0 i0 r1 i1 */
+    __m128 x1 = _mm_loadu_ps(p + 4);    /* r2 i2 r3 i3 */
+    x0 = _mm_mul_ps(x0, x0);
+    x1 = _mm_mul_ps(x1, x1);
+    return _mm_add_ps(_mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)),
+                      _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static inline __m128
+power4_sse2(const double *p)
+{
+    /* powers are computed in double precision, then rounded */
+    __m128 halves[2];
+    for (int h = 0; h < 2; h++) {
+        __m128d x0 = _mm_loadu_pd(p + 4 * h);       /* r0 i0 */
+        __m128d x1 = _mm_loadu_pd(p + 4 * h + 2);   /* r1 i1 */
+        x0 = _mm_mul_pd(x0, x0);
+        x1 = _mm_mul_pd(x1, x1);
+        halves[h] = _mm_cvtpd_ps(_mm_add_pd(_mm_unpacklo_pd(x0, x1), _mm_unpackhi_pd(x0, x1)));
+    }
+    return _mm_movelh_ps(halves[0], halves[1]);
+}
+
+static inline void
+store4_sse2(float *out, __m128 v)
+{
+    _mm_storeu_ps(out, v);
+}
+
+static inline void
+store4_sse2(double *out, __m128 v)
+{
+    _mm_storeu_pd(out, _mm_cvtps_pd(v));
+    _mm_storeu_pd(out + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+}
+
+/**
+ * SSE2 kernel; maps whole groups of four values.
+ * @return Number of values mapped.
+ */
+template <class P>
+static std::size_t
+map_sse2(const P *in, std::size_t count, float a, float b, P *out)
+{
+    const __m128 va = _mm_set1_ps(a);
+    const __m128 vb = _mm_set1_ps(b);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        store4_sse2(out + i, levels4_sse2(power4_sse2(in + 2 * i), va, vb));
+    }
+    return i;
+}
+
+/**
+ * Computes normalized levels from eight powers, using AVX2.
+ */
+__attribute__((target("avx2"))) static inline __m256
+levels8_avx2(__m256 power, __m256 a, __m256 b)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    power = _mm256_max_ps(power, _mm256_set1_ps(std::numeric_limits<float>::min()));
+    power = _mm256_min_ps(power, _mm256_set1_ps(std::numeric_limits<float>::max()));
+
+    __m256i bits = _mm256_castps_si256(power);
+    __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                   _mm256_set1_epi32(0x3f800000)));
+    __m256 above = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrt2), _CMP_GT_OQ);
+    m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), above);
+    e = _mm256_sub_epi32(e, _mm256_castps_si256(above)); /* mask is -1 */
+
+    __m256 t = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+    __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 poly = _mm256_add_ps(_mm256_set1_ps(kLog2C5), _mm256_mul_ps(t2, _mm256_set1_ps(kLog2C7)));
+    poly = _mm256_add_ps(_mm256_set1_ps(kLog2C3), _mm256_mul_ps(t2, poly));
+    poly = _mm256_add_ps(_mm256_set1_ps(kLog2C1), _mm256_mul_ps(t2, poly));
+    __m256 log2 = _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_mul_ps(t, poly));
+
+    __m256 value = _mm256_add_ps(_mm256_mul_ps(log2, a), b);
+    value = _mm256_max_ps(value, _mm256_setzero_ps());
+    return _mm256_min_ps(value, one);
+}
+
+/**
+ * Computes the powers of eight complex values, using AVX2.
+ */
+__attribute__((target("avx2"))) static inline __m256
+power8_avx2(const float *p)
+{
+    __m256 x0 = _mm256_loadu_ps(p);         /* r0 i0 r1 i1 | r2 i2 r3 i3 */
+    __m256 x1 = _mm256_loadu_ps(p + 8);     /* r4 i4 r5 i5 | r6 i6 r7 i7 */
+    x0 = _mm256_mul_ps(x0, x0);
+    x1 = _mm256_mul_ps(x1, x1);
+    __m256 power = _mm256_add_ps(_mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0)),
+                                 _mm256_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1))); /* p0 p1 p4 p5 | p2 p3 p6 p7 */
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(power), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+__attribute__((target("avx2"))) static inline __m256
+power8_avx2(const double *p)
+{
+    /* powers are computed in double precision, then rounded */
+    __m128 halves[2];
+    for (int h = 0; h < 2; h++) {
+        __m256d x0 = _mm256_loadu_pd(p + 8 * h);        /* r0 i0 r1 i1 */
+        __m256d x1 = _mm256_loadu_pd(p + 8 * h + 4);    /* r2 i2 r3 i3 */
+        x0 = _mm256_mul_pd(x0, x0);
+        x1 = _mm256_mul_pd(x1, x1);
+        __m256d power = _mm256_hadd_pd(x0, x1);         /* p0 p2 p1 p3 */
+        halves[h] = _mm256_cvtpd_ps(_mm256_permute4x64_pd(power, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(halves[0]), halves[1], 1);
+}
+
+__attribute__((target("avx2"))) static inline void
+store8_avx2(float *out, __m256 v)
+{
+    _mm256_storeu_ps(out, v);
+}
+
+__attribute__((target("avx2"))) static inline void
+store8_avx2(double *out, __m256 v)
+{
+    _mm256_storeu_pd(out, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(out + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+}
+
+/**
+ * AVX2 kernel; maps whole groups of eight values.
+ * @return Number of values mapped.
+ */
+template <class P>
+__attribute__((target("avx2"))) static std::size_t
+map_avx2(const P *in, std::size_t count, float a, float b, P *out)
+{
+    const __m256 va = _mm256_set1_ps(a);
+    const __m256 vb = _mm256_set1_ps(b);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        store8_avx2(out + i, levels8_avx2(power8_avx2(in + 2 * i), va, vb));
+    }
+    return i;
+}
+
+#endif
+
+template <class P>
+void
+MapPowerToDecibels(std::span<const std::complex<P>> input, double gain, double lower, double upper,
+                   std::span<P> output, SimdLevel level)
+{
+    static const SimdLevel supported = GetSupportedSimdLevel();
+    if (output.size() != input.size()) {
+        throw std::runtime_error("output window size must match input size");
+    }
+    level = std::min(level, supported);
+
+    /* normalized level is (10 log10(power) + gain - lower) / (upper - lower), i.e. a * log2(power) + b */
+    auto a = static_cast<float>(kDecibelsPerOctave / (upper - lower));
+    auto b = static_cast<float>((gain - lower) / (upper - lower));
+
+    /* std::complex<P> is guaranteed to be laid out as P[2] */
+    auto in = reinterpret_cast<const P *>(input.data());
+    std::size_t done = 0;
+#ifdef SPECGRAM_X86_KERNELS
+    if (level == SimdLevel::kAVX2) {
+        done = map_avx2<P>(in, input.size(), a, b, output.data());
+    } else if (level == SimdLevel::kSSE2) {
+        done = map_sse2<P>(in, input.size(), a, b, output.data());
+    }
+#endif
+    map_scalar<P>(in, done, input.size(), a, b, output.data());
+}
+
+template void MapPowerToDecibels<float>(std::span<const std::complex<float>>, double, double, double,
+                                        std::span<float>, SimdLevel);
+template void MapPowerToDecibels<double>(std::span<const std::complex<double>>, double, double, double,
+                                         std::span<double>, SimdLevel);
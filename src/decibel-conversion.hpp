@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _DECIBEL_CONVERSION_HPP_
+#define _DECIBEL_CONVERSION_HPP_
+
+#include "sample-conversion.hpp"
+
+#include <complex>
+#include <span>
+
+/**
+ * Maps complex values to a decibel scale, normalized to [0..1], in a single
+ * pass. The level of each value is computed from its power, as
+ * 10*log10(|z|^2), so no square root is needed.
+ * @tparam P Precision of values (float or double).
+ * @param input Complex values (e.g. FFT output).
+ * @param gain Gain applied to each level, in dB.
+ * @param lower Level mapped to 0.0, in dB.
+ * @param upper Level mapped to 1.0, in dB.
+ * @param output Window that receives the normalized levels, clamped to
+ *               [0..1]; must be the same size as input.
+ * @param level Kernel to use; levels the CPU does not support fall back to the
+ *              best supported one.
+ *
+ * NOTE: Uses a fast logarithm approximation, computed in single precision;
+ *       levels are within 1e-4 dB of the exact ones.
+ * NOTE: Powers are limited to the normal single precision range (about
+ *       -376 to +385 dB); zero and NaN map to the lower end of this range.
+ */
+template <class P>
+void MapPowerToDecibels(std::span<const std::complex<P>> input, double gain, double lower, double upper,
+                        std::span<P> output, SimdLevel level);
+
+/**
+ * Maps complex values to a decibel scale, normalized to [0..1], using the best
+ * kernel supported by the running CPU.
+ */
+template <class P>
+void MapPowerToDecibels(std::span<const std::complex<P>> input, double gain, double lower, double upper,
+                        std::span<P> output)
+{
+    static const SimdLevel level = GetSupportedSimdLevel();
+    MapPowerToDecibels<P>(input, gain, lower, upper, output, level);
+}
+
+#endif
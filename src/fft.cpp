@@ -12,6 +12,12 @@
 #include <cmath>
 #include <complex>
 #include <limits>
+#include <numeric>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPECGRAM_X86_KERNELS
+#endif
 
 static double
 sinc(double x)
@@ -39,99 +45,281 @@ sinc(double x)
     }
 }
 
-FFT::FFT(std::size_t win_width) : window_width_(win_width)
+static unsigned
+get_planner_flags(FFTPlanner planner)
+{
+    switch (planner) {
+        case FFTPlanner::kEstimate:
+            return FFTW_ESTIMATE;
+        case FFTPlanner::kMeasure:
+            return FFTW_MEASURE;
+        case FFTPlanner::kPatient:
+            return FFTW_PATIENT;
+        case FFTPlanner::kExhaustive:
+            return FFTW_EXHAUSTIVE;
+        default:
+            throw std::runtime_error("unknown fft planner");
+    }
+}
+
+template <class P>
+BasicFFT<P>::BasicFFT(std::size_t win_width, bool real_input, FFTPlanner planner, std::size_t batch_size)
+    : window_width_(win_width), real_input_(real_input), output_width_(real_input ? win_width / 2 + 1 : win_width),
+      batch_size_(batch_size), staged_count_(0), in_(nullptr), real_in_(nullptr), batch_plan_(nullptr)
 {
     /* no zero-width fft */
     if (win_width == 0) {
         throw std::runtime_error("cannot compute zero-width fft");
     }
+    if (batch_size == 0) {
+        throw std::runtime_error("fft batch size must be positive");
+    }
+
+    /* NOTE: planners other than FFTW_ESTIMATE overwrite the buffers, so plan before anything is stored in them */
+    unsigned flags = get_planner_flags(planner);
 
-    /* allocate buffers */
-    this->in_ = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * win_width);
-    assert(this->in_ != nullptr);
-    this->out_ = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * win_width);
+    /* windows are laid out back to back in the buffers, one slot per batch entry */
+    int n = static_cast<int>(win_width);
+    int howmany = static_cast<int>(batch_size);
+    int odist = static_cast<int>(this->output_width_);
+
+    /* allocate buffers; real-to-complex transforms only output non-negative frequencies */
+    if (real_input) {
+        this->real_in_ = FFTW::MallocReal(win_width * batch_size);
+        assert(this->real_in_ != nullptr);
+    } else {
+        this->in_ = FFTW::Malloc(win_width * batch_size);
+        assert(this->in_ != nullptr);
+    }
+    this->out_ = FFTW::Malloc(this->output_width_ * batch_size);
     assert(this->out_ != nullptr);
 
-    /* compute plan */
-    this->plan_ = fftw_plan_dft_1d(win_width, this->in_, this->out_, FFTW_FORWARD, FFTW_ESTIMATE);
+    /* compute plans; the single window plan operates on the first slot */
+    if (real_input) {
+        this->plan_ = FFTW::PlanDFTR2C1D(n, this->real_in_, this->out_, flags);
+        if (batch_size > 1) {
+            this->batch_plan_ = FFTW::PlanManyDFTR2C(1, &n, howmany, this->real_in_, n, this->out_, odist, flags);
+        }
+    } else {
+        this->plan_ = FFTW::PlanDFT1D(n, this->in_, this->out_, FFTW_FORWARD, flags);
+        if (batch_size > 1) {
+            this->batch_plan_ = FFTW::PlanManyDFT(1, &n, howmany, this->in_, n, this->out_, odist, FFTW_FORWARD,
+                                                  flags);
+        }
+    }
+}
+
+template <class P>
+BasicFFT<P>::BasicFFT(std::size_t win_width) : BasicFFT(win_width, false, FFTPlanner::kEstimate, 1)
+{
 }
 
-FFT::FFT(std::size_t win_width, std::unique_ptr<WindowFunction>& win_func) : FFT(win_width)
+template <class P>
+BasicFFT<P>::BasicFFT(std::size_t win_width, std::unique_ptr<BasicWindowFunction<P>>& win_func, bool real_input,
+                      FFTPlanner planner, std::size_t batch_size)
+    : BasicFFT(win_width, real_input, planner, batch_size)
 {
     this->window_function_ = std::move(win_func);
 }
 
-FFT::~FFT()
+template <class P>
+BasicFFT<P>::~BasicFFT()
 {
-    fftw_destroy_plan(this->plan_);
+    FFTW::DestroyPlan(this->plan_);
+    if (this->batch_plan_ != nullptr) {
+        FFTW::DestroyPlan(this->batch_plan_);
+    }
 
-    fftw_free(this->in_);
-    this->in_ = nullptr;
-    fftw_free(this->out_);
+    if (this->in_ != nullptr) {
+        FFTW::Free(this->in_);
+        this->in_ = nullptr;
+    }
+    if (this->real_in_ != nullptr) {
+        FFTW::Free(this->real_in_);
+        this->real_in_ = nullptr;
+    }
+    FFTW::Free(this->out_);
     this->out_ = nullptr;
 }
 
-ComplexWindow
-FFT::Compute(const ComplexWindow& input)
+template <class P>
+bool
+BasicFFT<P>::ImportWisdom(const std::string& filename)
+{
+    return FFTW::ImportWisdomFromFilename(filename.c_str());
+}
+
+template <class P>
+bool
+BasicFFT<P>::ExportWisdom(const std::string& filename)
+{
+    return FFTW::ExportWisdomToFilename(filename.c_str());
+}
+
+template <class P>
+void
+BasicFFT<P>::StageInto(std::span<const ValueType> input, std::size_t slot)
 {
     /* assume the same memory representation */
-    assert(sizeof(fftw_complex) == sizeof(Complex));
+    static_assert(sizeof(typename FFTW::ComplexType) == sizeof(ValueType));
 
     /* assume we received exactly one window */
     if (input.size() != this->window_width_) {
         throw std::runtime_error("input window size must match FFTW plan size");
     }
+    assert(slot < this->batch_size_);
+
+    if (this->real_input_) {
+        /* copy real parts to input buffer, applying the window function on the way */
+        assert(this->real_in_ != nullptr);
+        std::span<P> real_in(this->real_in_ + slot * this->window_width_, this->window_width_);
+        if (this->window_function_ != nullptr) {
+            this->window_function_->Apply(input, real_in);
+        } else {
+            std::transform(input.begin(), input.end(), real_in.begin(), [](const ValueType& v) { return v.real(); });
+        }
+    } else {
+        /* copy to input buffer, applying the window function on the way */
+        assert(this->in_ != nullptr);
+        auto in = this->in_ + slot * this->window_width_;
+        if (this->window_function_ != nullptr) {
+            this->window_function_->Apply(input, std::span<ValueType>(reinterpret_cast<ValueType *>(in),
+                                                                       this->window_width_));
+        } else {
+            std::memcpy((void *)in, (void *)input.data(), this->window_width_ * sizeof(ValueType));
+        }
+    }
+}
 
-    /* make a copy of the input and apply window function */
-    auto input_ref = &input;
-    ComplexWindow processed_input;
-    if (this->window_function_ != nullptr) {
-        processed_input = this->window_function_->Apply(input);
-        input_ref = &processed_input;
+template <class P>
+void
+BasicFFT<P>::CollectOutput(std::size_t slot, std::span<ValueType> output) const
+{
+    assert(this->out_ != nullptr);
+    assert(slot < this->batch_size_);
+    assert(output.size() == this->output_width_);
+    auto out = this->out_ + slot * this->output_width_;
+
+    /* fftw does not normalize; divide by the window size while copying, so the output is only walked once */
+    auto values = reinterpret_cast<const ValueType *>(out);
+    auto normalize = [n = (P)this->window_width_](const ValueType& v) { return v / n; };
+
+    if (this->real_input_) {
+        /* output is already in order, from DC up to the highest positive frequency */
+        std::transform(values, values + this->output_width_, output.begin(), normalize);
+    } else {
+        /* fftw maps frequencies to k/T for k=0..window_width; we want negative frequencies at the beginning of
+         * the output (i.e. first half) so we switch the upper and lower halves, i.e.: */
+        /*    even width: out_: [0 1 2 3 4 5 6 7] -> output: [5 6 7 0 1 2 3 4] */
+        /*     odd width: out_: [0 1 2 3 4 5 6]   -> output: [4 5 6 0 1 2 3] */
+        auto uhl = (this->window_width_ - 1) / 2; /* upper half length */
+        auto lhl = this->window_width_ - uhl; /* lower half length */
+        auto it = std::transform(values + lhl, values + this->window_width_, output.begin(), normalize);
+        std::transform(values, values + lhl, it, normalize);
     }
+}
 
-    /* copy to input buffer */
-    assert(this->in_ != nullptr);
-    std::memcpy((void *)this->in_, (void *)input_ref->data(), this->window_width_ * sizeof(fftw_complex));
+template <class P>
+BasicComplexWindow<P>
+BasicFFT<P>::Compute(std::span<const ValueType> input)
+{
+    BasicComplexWindow<P> output(this->output_width_);
+    this->Compute(input, output);
+    return output;
+}
+
+template <class P>
+void
+BasicFFT<P>::Compute(std::span<const ValueType> input, std::span<ValueType> output)
+{
+    /* the single window plan works on the first slot, which may hold a staged window */
+    if (this->staged_count_ > 0) {
+        throw std::runtime_error("cannot compute a single window while windows are staged");
+    }
+    if (output.size() != this->output_width_) {
+        throw std::runtime_error("output window size must match FFT output size");
+    }
 
-    /* execute plan */
-    fftw_execute(this->plan_);
+    this->StageInto(input, 0);
+    FFTW::Execute(this->plan_);
+    this->CollectOutput(0, output);
+}
+
+template <class P>
+void
+BasicFFT<P>::Stage(std::span<const ValueType> input)
+{
+    if (this->staged_count_ >= this->batch_size_) {
+        throw std::runtime_error("fft batch is full");
+    }
 
-    /* build output vector from output buffer */
-    /* fftw maps frequencies to k/T for k=0..window_width; we want negative frequencies at the beginning of
-     * the output (i.e. first half) so we switch the upper and lower halves, i.e.: */
-    /*    even width: out_: [0 1 2 3 4 5 6 7] -> output: [5 6 7 0 1 2 3 4] */
-    /*     odd width: out_: [0 1 2 3 4 5 6]   -> output: [4 5 6 0 1 2 3] */
-    ComplexWindow output;
-    output.resize(this->window_width_);
+    this->StageInto(input, this->staged_count_);
+    this->staged_count_++;
+}
 
-    assert(this->out_ != nullptr);
-    auto uhl = (this->window_width_ - 1) / 2; /* upper half length */
-    auto lhl = this->window_width_ - uhl; /* lower half length */
-    std::memcpy((void *) output.data(),
-                (void *) (this->out_ + lhl),
-                uhl * sizeof(fftw_complex));
-    std::memcpy((void *) (output.data() + uhl),
-                (void *) this->out_,
-                lhl * sizeof(fftw_complex));
+template <class P>
+std::vector<BasicComplexWindow<P>>
+BasicFFT<P>::ComputeBatch()
+{
+    BasicComplexWindow<P> values(this->staged_count_ * this->output_width_);
+    auto count = this->ComputeBatch(values);
 
-    /* fftw does not normalize; divide by the window size */
-    for (auto& v : output) {
-        v /= (double)output.size();
+    std::vector<BasicComplexWindow<P>> outputs;
+    outputs.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        outputs.emplace_back(values.begin() + i * this->output_width_, values.begin() + (i + 1) * this->output_width_);
     }
+    return outputs;
+}
+
+template <class P>
+std::size_t
+BasicFFT<P>::ComputeBatch(std::span<ValueType> output)
+{
+    auto count = this->staged_count_;
+    if (count == 0) {
+        return 0;
+    }
+    if (output.size() < count * this->output_width_) {
+        throw std::runtime_error("output too small for fft batch");
+    }
+
+    /* execute plan; a partial batch still transforms every slot, but only staged ones are collected */
+    if (count == 1) {
+        FFTW::Execute(this->plan_);
+    } else {
+        assert(this->batch_plan_ != nullptr);
+        FFTW::Execute(this->batch_plan_);
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+        this->CollectOutput(i, output.subspan(i * this->output_width_, this->output_width_));
+    }
+    this->staged_count_ = 0;
+
+    return count;
+}
 
+template <class P>
+BasicRealWindow<P>
+BasicFFT<P>::GetMagnitude(const BasicComplexWindow<P>& input, bool alias)
+{
+    BasicRealWindow<P> output(input.size());
+    BasicFFT::GetMagnitude(input, alias, output);
     return output;
 }
 
-RealWindow
-FFT::GetMagnitude(const ComplexWindow& input, bool alias)
+template <class P>
+void
+BasicFFT<P>::GetMagnitude(std::span<const ValueType> input, bool alias, std::span<P> output)
 {
     auto n = input.size();
+    if (output.size() != n) {
+        throw std::runtime_error("magnitude window size must match input size");
+    }
 
-    RealWindow output;
-    output.resize(n);
     for (std::size_t i = 0; i < n; i++) {
-        output[i] = std::abs<double>(input[i]);
+        output[i] = std::abs<P>(input[i]);
     }
 
     /* alias negative/positive frequencies (e.g. if input is not true complex) */
@@ -142,12 +330,71 @@ FFT::GetMagnitude(const ComplexWindow& input, bool alias)
             output[n - i - offset] = output[i];
         }
     }
+}
+
+template <class P>
+BasicRealWindow<P>
+BasicFFT<P>::GetHalfSpectrumMagnitude(const BasicComplexWindow<P>& input, std::size_t width, bool alias)
+{
+    BasicRealWindow<P> output(input.size());
+    BasicFFT::GetHalfSpectrumMagnitude(input, width, alias, output);
+    return output;
+}
+
+template <class P>
+void
+BasicFFT<P>::GetHalfSpectrumMagnitude(std::span<const ValueType> input, std::size_t width, bool alias,
+                                      std::span<P> output)
+{
+    auto n = width / 2 + 1;
+    if (input.size() != n || output.size() != n) {
+        throw std::runtime_error("half spectrum size does not match FFT width");
+    }
+
+    for (std::size_t i = 0; i < n; i++) {
+        output[i] = std::abs<P>(input[i]);
+    }
+
+    /* alias negative/positive frequencies; for real input these have the same magnitude, so double all
+     * terms that have a counterpart (i.e. all but DC and, for even widths, Nyquist) */
+    if (alias) {
+        std::size_t last = (width % 2 == 0) ? n - 1 : n;
+        for (std::size_t i = 1; i < last; i++) {
+            output[i] *= 2;
+        }
+    }
+}
 
+template <class P>
+BasicRealWindow<P>
+BasicFFT<P>::MirrorHalfSpectrum(const BasicRealWindow<P>& input, std::size_t width)
+{
+    BasicRealWindow<P> output(width);
+    BasicFFT::MirrorHalfSpectrum(input, width, output);
     return output;
 }
 
+template <class P>
+void
+BasicFFT<P>::MirrorHalfSpectrum(std::span<const P> input, std::size_t width, std::span<P> output)
+{
+    auto n = width / 2 + 1;
+    if (input.size() != n || output.size() != width) {
+        throw std::runtime_error("half spectrum size does not match FFT width");
+    }
+
+    /* same layout as Compute() for complex input, i.e. DC is at index uhl and negative frequencies come
+     * first; for a real signal, the term for frequency -k has the same magnitude as the one for k */
+    auto uhl = (width - 1) / 2; /* upper half length */
+    std::copy(input.begin(), input.end(), output.begin() + uhl);
+    for (std::size_t k = 1; k <= uhl; k++) {
+        output[uhl - k] = input[k];
+    }
+}
+
+template <class P>
 std::tuple<double, double>
-FFT::GetFrequencyLimits(double rate, std::size_t width)
+BasicFFT<P>::GetFrequencyLimits(double rate, std::size_t width)
 {
     if (rate <= 0) {
         throw std::runtime_error("rate must be positive in order to compute frequency limits");
@@ -167,89 +414,356 @@ FFT::GetFrequencyLimits(double rate, std::size_t width)
     }
 }
 
+template <class P>
 double
-FFT::GetFrequencyIndex(double rate, std::size_t width, double f)
+BasicFFT<P>::GetFrequencyIndex(double rate, std::size_t width, double f)
 {
-    auto [in_fmin, in_fmax] = FFT::GetFrequencyLimits(rate, width);
+    auto [in_fmin, in_fmax] = BasicFFT::GetFrequencyLimits(rate, width);
     assert(in_fmin < in_fmax);
     return (f - in_fmin) / (in_fmax - in_fmin) * (width - 1);
 }
 
-RealWindow
-FFT::Resample(const RealWindow& input, double rate, std::size_t width, double fmin, double fmax)
+template <class P>
+BasicRealWindow<P>
+BasicFFT<P>::Resample(const BasicRealWindow<P>& input, double rate, std::size_t width, double fmin, double fmax)
+{
+    BasicRealWindow<P> output(width);
+    BasicFFT::Resample(input, rate, fmin, fmax, output);
+    return output;
+}
+
+template <class P>
+void
+BasicFFT<P>::Resample(std::span<const P> input, double rate, double fmin, double fmax, std::span<P> output)
+{
+    BasicResamplePlan<P>(input.size(), rate, output.size(), fmin, fmax).Apply(input, output);
+}
+
+template <class P>
+std::tuple<std::size_t, std::size_t>
+BasicFFT<P>::GetCropBounds(std::size_t size, double rate, double fmin, double fmax)
 {
     if (rate <= 0.0f) {
-        throw std::runtime_error("rate must be positive for resampling");
+        throw std::runtime_error("rate must be positive for cropping");
     }
     if (fmin >= fmax) {
-        throw std::runtime_error("resampling frequency bounds either not distinct or not in order");
-    }
-    if (width == 0) {
-        throw std::runtime_error("resampling requires positive width");
+        throw std::runtime_error("cropping frequency bounds either not distinct or not in order");
     }
 
     /* find corresponding indices for fmin/fmax */
-    /* [0..input.size()-1] -> [in_fmin, in_fmax] */
-    /*   [i_fmin..i_fmax]  ->    [fmin, fmax]    */
-    double i_fmin = FFT::GetFrequencyIndex(rate, input.size(), fmin);
-    double i_fmax = FFT::GetFrequencyIndex(rate, input.size(), fmax);
-
-    /* prepare output */
-    RealWindow output;
-    output.resize(width);
-
-    /* [0..width] -> [i_fmin..i_fmax] */
-    /* Lanczos resampling */
-    static constexpr std::size_t lanc_a = 3;
-    for (std::size_t j = 0; j < width; j++) {
-        double x = (double)j / (double)(width - 1) * (i_fmax - i_fmin) + i_fmin;
-        double sum = 0.0f;
-        double lsum = 0.0f;
+    /* [0..size-1] -> [in_fmin, in_fmax] */
+    /* [i_fmin..i_fmax]  ->    [fmin, fmax]    */
+    double di_fmin = std::round(BasicFFT::GetFrequencyIndex(rate, size, fmin));
+    double di_fmax = std::round(BasicFFT::GetFrequencyIndex(rate, size, fmax));
 
-        /* convolve */
-        for (int i = static_cast<int>(std::floor(x)) - static_cast<int>(lanc_a) + 1; i <= std::floor(x) + lanc_a; i ++) {
-            if (i >= 0 && i < static_cast<int>(input.size())) {
-                double lanc_xi = ::sinc(x - i) * ::sinc((x - i) / lanc_a);
-                sum += input[i] * lanc_xi;
-                lsum += lanc_xi;
-            }
-        }
+    /* we're cropping, so no interpolation allowed */
+    auto i_fmin = static_cast<int64_t>(di_fmin);
+    auto i_fmax = static_cast<int64_t>(di_fmax);
+
+    if (i_fmin < 0) {
+        throw std::runtime_error("fmin outside of window");
+    }
+    if (i_fmax >= (int64_t)size) {
+        throw std::runtime_error("fmax outside of window");
+    }
+
+    return std::make_tuple(static_cast<std::size_t>(i_fmin), static_cast<std::size_t>(i_fmax) + 1);
+}
+
+template <class P>
+BasicRealWindow<P>
+BasicFFT<P>::Crop(const BasicRealWindow<P>& input, double rate, double fmin, double fmax)
+{
+    auto [begin, end] = BasicFFT::GetCropBounds(input.size(), rate, fmin, fmax);
+
+    /* return corresponding subvector */
+    return BasicRealWindow<P>(input.begin() + begin, input.begin() + end);
+}
+
+template <class P>
+void
+BasicFFT<P>::Crop(std::span<const P> input, double rate, double fmin, double fmax, std::span<P> output)
+{
+    auto [begin, end] = BasicFFT::GetCropBounds(input.size(), rate, fmin, fmax);
+    if (output.size() != end - begin) {
+        throw std::runtime_error("output window size must match cropped size");
+    }
+
+    /* copy corresponding subvector */
+    std::copy(input.begin() + begin, input.begin() + end, output.begin());
+}
 
-        double value = sum / lsum;
+/*
+ * Lanczos resampling kernels. Output value j is the sum over its taps t of in[first[j] + t] * weights[t * stride + j],
+ * accumulated in double precision and in order of t, divided by sums[j]. Vector kernels compute neighbouring output
+ * values in separate lanes, with the same operations in the same order as the scalar kernel, so results are identical.
+ * All kernels store NaN as 0 and clamp to [0..1].
+ */
+
+/**
+ * Scalar kernel, for any number of taps; also used for the edges and tails of the vector kernels.
+ * @param begin Index of first output value to compute.
+ * @param end Index past the last output value to compute.
+ */
+template <class P>
+static void
+lanczos_scalar(const P *in, const std::size_t *first, const std::size_t *counts, const double *weights,
+               std::size_t stride, const double *sums, std::size_t begin, std::size_t end, P *out)
+{
+    for (std::size_t j = begin; j < end; j++) {
+        double sum = 0.0f;
+        for (std::size_t t = 0; t < counts[j]; t++) {
+            sum += in[first[j] + t] * weights[t * stride + j];
+        }
+        double value = sum / sums[j];
         value = std::isnan(value) ? 0.0 : value;
-        output[j] = std::clamp<double>(value, 0.0f, 1.0f);
+        out[j] = static_cast<P>(std::clamp<double>(value, 0.0f, 1.0f));
     }
+}
 
-    return output;
+#ifdef SPECGRAM_X86_KERNELS
+
+static inline void
+store2_sse2(float *out, __m128d v)
+{
+    _mm_storel_pi(reinterpret_cast<__m64 *>(out), _mm_cvtpd_ps(v));
+}
+
+static inline void
+store2_sse2(double *out, __m128d v)
+{
+    _mm_storeu_pd(out, v);
+}
+
+/**
+ * SSE2 kernel, for output values with all of their TAP_COUNT taps; computes pairs of output values.
+ * @return Index past the last output value computed.
+ */
+template <class P, std::size_t TAP_COUNT>
+static std::size_t
+lanczos_sse2(const P *in, const std::size_t *first, const double *weights, std::size_t stride, const double *sums,
+             std::size_t begin, std::size_t end, P *out)
+{
+    std::size_t j = begin;
+    for (; j + 2 <= end; j += 2) {
+        const P *in0 = in + first[j];
+        const P *in1 = in + first[j + 1];
+        __m128d sum = _mm_setzero_pd();
+        for (std::size_t t = 0; t < TAP_COUNT; t++) {
+            __m128d v = _mm_set_pd(in1[t], in0[t]);
+            sum = _mm_add_pd(sum, _mm_mul_pd(v, _mm_loadu_pd(weights + t * stride + j)));
+        }
+        /* NaN fails the maximum and becomes 0 */
+        __m128d value = _mm_div_pd(sum, _mm_loadu_pd(sums + j));
+        value = _mm_min_pd(_mm_max_pd(value, _mm_setzero_pd()), _mm_set1_pd(1.0));
+        store2_sse2(out + j, value);
+    }
+    return j;
+}
+
+__attribute__((target("avx2"))) static inline __m256d
+gather4_avx2(const float *in, __m256i indices)
+{
+    return _mm256_cvtps_pd(_mm256_i64gather_ps(in, indices, sizeof(float)));
+}
+
+__attribute__((target("avx2"))) static inline __m256d
+gather4_avx2(const double *in, __m256i indices)
+{
+    return _mm256_i64gather_pd(in, indices, sizeof(double));
+}
+
+__attribute__((target("avx2"))) static inline void
+store4_avx2(float *out, __m256d v)
+{
+    _mm_storeu_ps(out, _mm256_cvtpd_ps(v));
 }
 
-RealWindow
-FFT::Crop(const RealWindow& input, double rate, double fmin, double fmax)
+__attribute__((target("avx2"))) static inline void
+store4_avx2(double *out, __m256d v)
+{
+    _mm256_storeu_pd(out, v);
+}
+
+/**
+ * AVX2 kernel, for output values with all of their TAP_COUNT taps; computes groups of four output values, gathering
+ * their inputs.
+ * @return Index past the last output value computed.
+ */
+template <class P, std::size_t TAP_COUNT>
+__attribute__((target("avx2"))) static std::size_t
+lanczos_avx2(const P *in, const std::size_t *first, const double *weights, std::size_t stride, const double *sums,
+             std::size_t begin, std::size_t end, P *out)
+{
+    static_assert(sizeof(std::size_t) == sizeof(int64_t));
+    std::size_t j = begin;
+    for (; j + 4 <= end; j += 4) {
+        __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + j));
+        __m256d sum = _mm256_setzero_pd();
+        for (std::size_t t = 0; t < TAP_COUNT; t++) {
+            __m256d v = gather4_avx2(in + t, indices);
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(v, _mm256_loadu_pd(weights + t * stride + j)));
+        }
+        /* NaN fails the maximum and becomes 0 */
+        __m256d value = _mm256_div_pd(sum, _mm256_loadu_pd(sums + j));
+        value = _mm256_min_pd(_mm256_max_pd(value, _mm256_setzero_pd()), _mm256_set1_pd(1.0));
+        store4_avx2(out + j, value);
+    }
+    return j;
+}
+
+#endif
+
+template <class P>
+BasicResamplePlan<P>::BasicResamplePlan(std::size_t input_size, double rate, std::size_t width, double fmin,
+                                        double fmax, FrequencyReduction reduction)
+    : input_size_(input_size), output_size_(width), reduction_(reduction), full_begin_(0), full_end_(0)
 {
     if (rate <= 0.0f) {
-        throw std::runtime_error("rate must be positive for cropping");
+        throw std::runtime_error("rate must be positive for resampling");
     }
     if (fmin >= fmax) {
-        throw std::runtime_error("cropping frequency bounds either not distinct or not in order");
+        throw std::runtime_error("resampling frequency bounds either not distinct or not in order");
+    }
+    if (width == 0) {
+        throw std::runtime_error("resampling requires positive width");
     }
 
     /* find corresponding indices for fmin/fmax */
-    /* [0..input.size()-1] -> [in_fmin, in_fmax] */
+    /* [0..input_size-1] -> [in_fmin, in_fmax] */
     /*   [i_fmin..i_fmax]  ->    [fmin, fmax]    */
-    double di_fmin = std::round(FFT::GetFrequencyIndex(rate, input.size(), fmin));
-    double di_fmax = std::round(FFT::GetFrequencyIndex(rate, input.size(), fmax));
+    double i_fmin = BasicFFT<P>::GetFrequencyIndex(rate, input_size, fmin);
+    double i_fmax = BasicFFT<P>::GetFrequencyIndex(rate, input_size, fmax);
+
+    if (reduction == FrequencyReduction::kLanczos) {
+        /* [0..width] -> [i_fmin..i_fmax] */
+        /* Lanczos resampling; taps that fall outside the input are dropped rather than given a zero weight, as
+         * 0 * inf would still poison the sum. A single output value sits at the center of the band. */
+        this->first_bins_.resize(width);
+        this->tap_counts_.resize(width);
+        this->weights_.resize(TAP_COUNT * width, 0.0);
+        this->weight_sums_.resize(width);
+        for (std::size_t j = 0; j < width; j++) {
+            double x = (width > 1) ? (double)j / (double)(width - 1) * (i_fmax - i_fmin) + i_fmin
+                                   : (i_fmin + i_fmax) / 2.0;
+            double lsum = 0.0f;
+
+            /* first tap, limited so that bands far outside of the input stay representable */
+            double first = std::clamp<double>(std::floor(x) - LANCZOS_A + 1.0, -(double)TAP_COUNT, (double)input_size);
+            int64_t begin = std::max<int64_t>(static_cast<int64_t>(first), 0);
+            int64_t end = std::min<int64_t>(static_cast<int64_t>(first) + TAP_COUNT, input_size);
+            for (int64_t i = begin; i < end; i++) {
+                double lanc_xi = ::sinc(x - i) * ::sinc((x - i) / LANCZOS_A);
+                this->weights_[(i - begin) * width + j] = lanc_xi;
+                lsum += lanc_xi;
+            }
+            this->first_bins_[j] = static_cast<std::size_t>(std::min<int64_t>(begin, input_size));
+            this->tap_counts_[j] = static_cast<std::size_t>(std::max<int64_t>(end - begin, 0));
+            this->weight_sums_[j] = lsum;
+        }
 
-    /* we're cropping, so no interpolation allowed */
-    auto i_fmin = static_cast<int64_t>(di_fmin);
-    auto i_fmax = static_cast<int64_t>(di_fmax);
+        /* taps move along the input with the output value, so those with all taps form a range */
+        auto full = [](std::size_t count) { return count == TAP_COUNT; };
+        this->full_begin_ = std::find_if(this->tap_counts_.begin(), this->tap_counts_.end(), full)
+                            - this->tap_counts_.begin();
+        this->full_end_ = std::find_if_not(this->tap_counts_.begin() + this->full_begin_, this->tap_counts_.end(), full)
+                          - this->tap_counts_.begin();
+        assert(std::none_of(this->tap_counts_.begin() + this->full_end_, this->tap_counts_.end(), full));
+    } else if (reduction == FrequencyReduction::kMax || reduction == FrequencyReduction::kMean) {
+        /* output value j is centered at the same bin position as in Lanczos resampling, and pools all bins closer
+         * to it than to its neighbours; a single output value pools the whole band */
+        double step = (width > 1) ? (i_fmax - i_fmin) / (double)(width - 1) : (i_fmax - i_fmin);
+        double start = (width > 1) ? i_fmin : (i_fmin + i_fmax) / 2.0;
+        /* first bin of output value j, i.e. first bin at or above its lower edge; also one past its last bin */
+        auto edge_bin = [=](std::size_t j) {
+            double edge = start + ((double)j - 0.5) * step;
+            return static_cast<std::size_t>(std::clamp<double>(std::ceil(edge), 0.0, (double)input_size));
+        };
+
+        this->first_bins_.resize(width);
+        this->bin_counts_.resize(width);
+        for (std::size_t j = 0; j < width; j++) {
+            double center = start + (double)j * step;
+            std::size_t first = edge_bin(j);
+            std::size_t last = edge_bin(j + 1);
+            if (first >= last) {
+                /* upsampling; no bin falls in this output value, use the nearest one (if any) */
+                double nearest = std::round(center);
+                first = static_cast<std::size_t>(std::clamp<double>(nearest, 0.0, (double)input_size));
+                last = (nearest >= 0.0 && nearest < (double)input_size) ? first + 1 : first;
+            }
+            this->first_bins_[j] = first;
+            this->bin_counts_[j] = last - first;
+        }
+    } else {
+        throw std::runtime_error("unknown frequency reduction");
+    }
+}
 
-    if (i_fmin < 0) {
-        throw std::runtime_error("fmin outside of window");
+template <class P>
+void
+BasicResamplePlan<P>::Apply(std::span<const P> input, std::span<P> output, SimdLevel level) const
+{
+    if (input.size() != this->input_size_) {
+        throw std::runtime_error("input size does not match resample plan");
     }
-    if (i_fmax >= (int64_t)input.size()) {
-        throw std::runtime_error("fmax outside of window");
+    if (output.size() != this->output_size_) {
+        throw std::runtime_error("output size does not match resample plan");
     }
 
-    /* return corresponding subvector */
-    return RealWindow(input.begin() + i_fmin, input.begin() + i_fmax + 1);
+    /* one pass per reduction, so the inner loops do not branch on it */
+    auto store = [&output](std::size_t j, double value) {
+        value = std::isnan(value) ? 0.0 : value;
+        output[j] = static_cast<P>(std::clamp<double>(value, 0.0f, 1.0f));
+    };
+
+    switch (this->reduction_) {
+        case FrequencyReduction::kLanczos: {
+            /* convolve; an output value without taps (band outside of input) divides 0 by 0 and is stored as 0.
+             * Output values with all their taps are handed to the vector kernels, the edges to the scalar one */
+            static const SimdLevel supported = GetSupportedSimdLevel();
+            level = std::min(level, supported);
+
+            const P *in = input.data();
+            const std::size_t *first = this->first_bins_.data();
+            const double *weights = this->weights_.data();
+            const double *sums = this->weight_sums_.data();
+            P *out = output.data();
+            std::size_t done = this->full_begin_;
+            lanczos_scalar<P>(in, first, this->tap_counts_.data(), weights, this->output_size_, sums,
+                              0, this->full_begin_, out);
+#ifdef SPECGRAM_X86_KERNELS
+            if (level == SimdLevel::kAVX2) {
+                done = lanczos_avx2<P, TAP_COUNT>(in, first, weights, this->output_size_, sums,
+                                                  this->full_begin_, this->full_end_, out);
+            } else if (level == SimdLevel::kSSE2) {
+                done = lanczos_sse2<P, TAP_COUNT>(in, first, weights, this->output_size_, sums,
+                                                  this->full_begin_, this->full_end_, out);
+            }
+#endif
+            lanczos_scalar<P>(in, first, this->tap_counts_.data(), weights, this->output_size_, sums,
+                              done, this->output_size_, out);
+            break;
+        }
+
+        case FrequencyReduction::kMax:
+            for (std::size_t j = 0; j < this->output_size_; j++) {
+                auto bins = input.subspan(this->first_bins_[j], this->bin_counts_[j]);
+                store(j, bins.empty() ? 0.0 : *std::max_element(bins.begin(), bins.end()));
+            }
+            break;
+
+        case FrequencyReduction::kMean:
+            for (std::size_t j = 0; j < this->output_size_; j++) {
+                auto bins = input.subspan(this->first_bins_[j], this->bin_counts_[j]);
+                store(j, bins.empty() ? 0.0 : std::accumulate(bins.begin(), bins.end(), 0.0) / (double)bins.size());
+            }
+            break;
+    }
 }
+
+template class BasicResamplePlan<float>;
+template class BasicResamplePlan<double>;
+
+template class BasicFFT<float>;
+template class BasicFFT<double>;
@@ -9,61 +9,287 @@
 #define _FFT_HPP_
 
 #include "window-function.hpp"
+#include "sample-conversion.hpp"
 
 #include <fftw3.h>
+#include <string>
+
+/**
+ * Rigor of FFTW planning; more rigorous planners take longer to create a plan,
+ * but may produce faster transforms
+ */
+enum class FFTPlanner {
+    kEstimate,
+    kMeasure,
+    kPatient,
+    kExhaustive
+};
+
+/**
+ * Method of reducing FFT bins to display width
+ */
+enum class FrequencyReduction {
+    kLanczos,   /* Lanczos resampling */
+    kMax,       /* maximum of all bins pooled into each output value */
+    kMean       /* mean of all bins pooled into each output value */
+};
+
+/**
+ * Maps a precision to the matching FFTW interface (fftw_* for double, fftwf_* for float).
+ */
+template <class P>
+struct FFTWTraits;
+
+template <>
+struct FFTWTraits<double> {
+    using ComplexType = fftw_complex;
+    using PlanType = fftw_plan;
+
+    static ComplexType *Malloc(std::size_t n) { return (ComplexType *) fftw_malloc(sizeof(ComplexType) * n); }
+    static void Free(void *p) { fftw_free(p); }
+    static double *MallocReal(std::size_t n) { return (double *) fftw_malloc(sizeof(double) * n); }
+    static PlanType PlanDFT1D(int n, ComplexType *in, ComplexType *out, int sign, unsigned flags)
+    {
+        return fftw_plan_dft_1d(n, in, out, sign, flags);
+    }
+    static PlanType PlanDFTR2C1D(int n, double *in, ComplexType *out, unsigned flags)
+    {
+        return fftw_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static PlanType PlanManyDFT(int rank, const int *n, int howmany, ComplexType *in, int idist, ComplexType *out,
+                                int odist, int sign, unsigned flags)
+    {
+        return fftw_plan_many_dft(rank, n, howmany, in, nullptr, 1, idist, out, nullptr, 1, odist, sign, flags);
+    }
+    static PlanType PlanManyDFTR2C(int rank, const int *n, int howmany, double *in, int idist, ComplexType *out,
+                                   int odist, unsigned flags)
+    {
+        return fftw_plan_many_dft_r2c(rank, n, howmany, in, nullptr, 1, idist, out, nullptr, 1, odist, flags);
+    }
+    static void Execute(PlanType p) { fftw_execute(p); }
+    static void DestroyPlan(PlanType p) { fftw_destroy_plan(p); }
+    static bool ImportWisdomFromFilename(const char *f) { return fftw_import_wisdom_from_filename(f) != 0; }
+    static bool ExportWisdomToFilename(const char *f) { return fftw_export_wisdom_to_filename(f) != 0; }
+};
+
+template <>
+struct FFTWTraits<float> {
+    using ComplexType = fftwf_complex;
+    using PlanType = fftwf_plan;
+
+    static ComplexType *Malloc(std::size_t n) { return (ComplexType *) fftwf_malloc(sizeof(ComplexType) * n); }
+    static void Free(void *p) { fftwf_free(p); }
+    static float *MallocReal(std::size_t n) { return (float *) fftwf_malloc(sizeof(float) * n); }
+    static PlanType PlanDFT1D(int n, ComplexType *in, ComplexType *out, int sign, unsigned flags)
+    {
+        return fftwf_plan_dft_1d(n, in, out, sign, flags);
+    }
+    static PlanType PlanDFTR2C1D(int n, float *in, ComplexType *out, unsigned flags)
+    {
+        return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static PlanType PlanManyDFT(int rank, const int *n, int howmany, ComplexType *in, int idist, ComplexType *out,
+                                int odist, int sign, unsigned flags)
+    {
+        return fftwf_plan_many_dft(rank, n, howmany, in, nullptr, 1, idist, out, nullptr, 1, odist, sign, flags);
+    }
+    static PlanType PlanManyDFTR2C(int rank, const int *n, int howmany, float *in, int idist, ComplexType *out,
+                                   int odist, unsigned flags)
+    {
+        return fftwf_plan_many_dft_r2c(rank, n, howmany, in, nullptr, 1, idist, out, nullptr, 1, odist, flags);
+    }
+    static void Execute(PlanType p) { fftwf_execute(p); }
+    static void DestroyPlan(PlanType p) { fftwf_destroy_plan(p); }
+    static bool ImportWisdomFromFilename(const char *f) { return fftwf_import_wisdom_from_filename(f) != 0; }
+    static bool ExportWisdomToFilename(const char *f) { return fftwf_export_wisdom_to_filename(f) != 0; }
+};
 
 /**
  * Computes the fast Fourier transform of an input window.
+ * @tparam P Precision of computations (float or double).
  */
-class FFT {
+template <class P>
+class BasicFFT {
+public:
+    /* type of window values */
+    using ValueType = std::complex<P>;
+
 private:
+    using FFTW = FFTWTraits<P>;
+
     /* FFT window width */
     const std::size_t window_width_;
 
-    /* fftw buffers */
-    fftw_complex *in_;
-    fftw_complex *out_;
+    /* input is real, so only the non-negative half of the spectrum is computed */
+    const bool real_input_;
 
-    /* fftw plan */
-    fftw_plan plan_;
+    /* number of terms in each output window (window_width_/2+1 for real input) */
+    const std::size_t output_width_;
+
+    /* number of windows that can be transformed at once, and number of windows staged so far */
+    const std::size_t batch_size_;
+    std::size_t staged_count_;
+
+    /* fftw buffers, holding batch_size_ windows back to back; only one of in_ and real_in_ is used, depending on
+     * real_input_ */
+    typename FFTW::ComplexType *in_;
+    P *real_in_;
+    typename FFTW::ComplexType *out_;
+
+    /* fftw plans, for a single window (first slot) and for the whole batch (null if batch_size_ is 1) */
+    typename FFTW::PlanType plan_;
+    typename FFTW::PlanType batch_plan_;
 
     /* window function */
-    std::unique_ptr<WindowFunction> window_function_;
+    std::unique_ptr<BasicWindowFunction<P>> window_function_;
+
+    /**
+     * @param win_width Width of window this object must support.
+     * @param real_input If true, plan a real-to-complex transform.
+     * @param planner Rigor of FFTW planning.
+     * @param batch_size Number of windows that can be staged for a batched
+     *                   computation.
+     */
+    BasicFFT(std::size_t win_width, bool real_input, FFTPlanner planner, std::size_t batch_size);
+
+    /**
+     * Copy a window into a buffer slot, applying the window function.
+     * @param input Array of complex input values.
+     * @param slot Index of slot in buffers.
+     */
+    void StageInto(std::span<const ValueType> input, std::size_t slot);
+
+    /**
+     * Build the (normalized) output window from a buffer slot, after a plan
+     * was executed.
+     * @param slot Index of slot in buffers.
+     * @param output Window that receives the output (see Compute()); must
+     *               have exactly GetOutputWidth() values.
+     */
+    void CollectOutput(std::size_t slot, std::span<ValueType> output) const;
+
+    /**
+     * @return Bounds [begin, end) of the window values to keep when cropping.
+     */
+    static std::tuple<std::size_t, std::size_t> GetCropBounds(std::size_t size, double rate, double fmin, double fmax);
 
 public:
     /* plan and buffers are not copiable */
-    FFT() = delete;
-    FFT(const FFT &c) = delete;
-    FFT(FFT &&) = delete;
-    FFT & operator=(const FFT&) = delete;
+    BasicFFT() = delete;
+    BasicFFT(const BasicFFT &c) = delete;
+    BasicFFT(BasicFFT &&) = delete;
+    BasicFFT & operator=(const BasicFFT&) = delete;
 
     /**
      * @param win_width Width of window this object must support.
      * NOTE: Only supports this window size!
      */
-    explicit FFT(std::size_t win_width);
+    explicit BasicFFT(std::size_t win_width);
 
     /**
      * @param win_width Width of window this object must support.
      * @param win_func Window function to apply before FFT computations.
+     * @param real_input If true, only the real part of the input is used and
+     *                   only the non-negative half of the spectrum is computed
+     *                   (real-to-complex transform).
+     * @param planner Rigor of FFTW planning; anything other than
+     *                FFTPlanner::kEstimate benchmarks candidate plans, which
+     *                can take a while unless matching wisdom was imported.
+     * @param batch_size Number of windows that can be staged with Stage() and
+     *                   transformed at once with ComputeBatch().
      * NOTE: Only supports this window size!
      */
-    FFT(std::size_t win_width, std::unique_ptr<WindowFunction>& win_func);
+    BasicFFT(std::size_t win_width, std::unique_ptr<BasicWindowFunction<P>>& win_func, bool real_input = false,
+             FFTPlanner planner = FFTPlanner::kEstimate, std::size_t batch_size = 1);
+
+    virtual ~BasicFFT();
+
+    /**
+     * @return True if computing real-to-complex transforms.
+     */
+    bool IsRealInput() const { return real_input_; }
+
+    /**
+     * @return Maximum number of windows that can be staged.
+     */
+    std::size_t GetBatchSize() const { return batch_size_; }
 
-    virtual ~FFT();
+    /**
+     * @return Number of windows currently staged.
+     */
+    std::size_t GetStagedCount() const { return staged_count_; }
+
+    /**
+     * @return Number of terms in each output window (width/2+1 for real input).
+     */
+    std::size_t GetOutputWidth() const { return output_width_; }
+
+    /**
+     * Import FFTW wisdom (previously accumulated plan information) for this
+     * precision from a file.
+     * @param filename Path of wisdom file.
+     * @return True if wisdom was successfully imported.
+     */
+    static bool ImportWisdom(const std::string& filename);
+
+    /**
+     * Export all FFTW wisdom accumulated so far for this precision to a file.
+     * @param filename Path of wisdom file; will be overwritten.
+     * @return True if wisdom was successfully exported.
+     */
+    static bool ExportWisdom(const std::string& filename);
 
     /**
      * Compute the fast Fourier transform.
      * @param input Array of complex input values.
-     * @return Complex values corresponding to the FFT terms, equal in size to input.
+     * @return Complex values corresponding to the FFT terms, equal in size to
+     *         input; for real input, only the width/2+1 non-negative frequency
+     *         terms, starting with DC.
      *
      * NOTE: This functions normalizes the output by 1/N.
-     * NOTE: This function provides the negative frequencies in the first half
-     *       and the positive frequencies in the second half.
+     * NOTE: For complex input, this function provides the negative frequencies
+     *       in the first half and the positive frequencies in the second half.
      * NOTE: For even-sized inputs, the Nyquist frequency term is the last in
      *       the output vector.
+     * NOTE: Cannot be called while windows are staged for a batch.
      */
-    ComplexWindow Compute(const ComplexWindow& input);
+    BasicComplexWindow<P> Compute(std::span<const ValueType> input);
+
+    /**
+     * Compute the fast Fourier transform into a caller provided window.
+     * @param input Array of complex input values.
+     * @param output Window that receives the output (see above); must have
+     *               exactly GetOutputWidth() values.
+     */
+    void Compute(std::span<const ValueType> input, std::span<ValueType> output);
+
+    /**
+     * Stage a window for a batched computation. The window function is applied
+     * and the values are copied, so input need not outlive this call.
+     * @param input Array of complex input values.
+     */
+    void Stage(std::span<const ValueType> input);
+
+    /**
+     * Compute the fast Fourier transforms of all staged windows at once.
+     * @return One output window (as returned by Compute()) for each staged
+     *         window, in staging order.
+     *
+     * NOTE: Unstages all windows.
+     */
+    std::vector<BasicComplexWindow<P>> ComputeBatch();
+
+    /**
+     * Compute the fast Fourier transforms of all staged windows at once, into
+     * a caller provided buffer.
+     * @param output Buffer that receives the output windows back to back;
+     *               must hold at least GetStagedCount() * GetOutputWidth()
+     *               values.
+     * @return Number of output windows.
+     *
+     * NOTE: Unstages all windows.
+     */
+    std::size_t ComputeBatch(std::span<ValueType> output);
 
     /**
      * Retrieve the (real) magnitudes of a complex input vector (window).
@@ -75,7 +301,50 @@ public:
      *       magnitude as well as the corresponding negative or positive
      *       frequency term's magnitude.
      */
-    static RealWindow GetMagnitude(const ComplexWindow& input, bool alias);
+    static BasicRealWindow<P> GetMagnitude(const BasicComplexWindow<P>& input, bool alias);
+
+    /**
+     * Retrieve the (real) magnitudes of a complex input vector (window), into
+     * a caller provided window of the same size.
+     */
+    static void GetMagnitude(std::span<const ValueType> input, bool alias, std::span<P> output);
+
+    /**
+     * Retrieve the (real) magnitudes of the non-negative half of the spectrum
+     * of a real signal, as computed by a real input FFT.
+     * @param input Array of width/2+1 complex values, starting with DC.
+     * @param width Width of the FFT window.
+     * @param alias If true, will alias negative and positive frequencies.
+     * @return Array of width/2+1 real values, containing amplitudes.
+     *
+     * NOTE: Since the spectrum of a real signal is symmetric, aliasing simply
+     *       doubles all terms except DC and (for even widths) Nyquist.
+     */
+    static BasicRealWindow<P> GetHalfSpectrumMagnitude(const BasicComplexWindow<P>& input, std::size_t width,
+                                                       bool alias);
+
+    /**
+     * Retrieve the (real) magnitudes of the non-negative half of the spectrum
+     * of a real signal, into a caller provided window of width/2+1 values.
+     */
+    static void GetHalfSpectrumMagnitude(std::span<const ValueType> input, std::size_t width, bool alias,
+                                         std::span<P> output);
+
+    /**
+     * Expand a real window computed over the non-negative half of the spectrum
+     * of a real signal to the full spectrum layout (as returned by
+     * GetMagnitude()), by mirroring it.
+     * @param input Array of width/2+1 real values, starting with DC.
+     * @param width Width of the FFT window.
+     * @return Array of width real values.
+     */
+    static BasicRealWindow<P> MirrorHalfSpectrum(const BasicRealWindow<P>& input, std::size_t width);
+
+    /**
+     * Expand a real window computed over the non-negative half of the spectrum
+     * into a caller provided window of width values.
+     */
+    static void MirrorHalfSpectrum(std::span<const P> input, std::size_t width, std::span<P> output);
 
     /**
      * Compute the frequency bounds of a specific FFT window.
@@ -106,8 +375,17 @@ public:
      * NOTE: Uses Lanczos resampling algorithm.
      * NOTE: Will resize the [fmin..fmax] band from input (computed as if
      *       input is a FFT output) to a width-sized output window.
+     * NOTE: Computes the resampling weights on every call; when resampling
+     *       many windows, use a BasicResamplePlan.
+     */
+    static BasicRealWindow<P> Resample(const BasicRealWindow<P>& input, double rate, std::size_t width,
+                                       double fmin, double fmax);
+
+    /**
+     * Resample a real, scaled output of the FFT into a caller provided window;
+     * the output width is that of the window.
      */
-    static RealWindow Resample(const RealWindow& input, double rate, std::size_t width, double fmin, double fmax);
+    static void Resample(std::span<const P> input, double rate, double fmin, double fmax, std::span<P> output);
 
     /**
      * Crop a real, scaled output of the FFT.
@@ -120,7 +398,95 @@ public:
      * NOTE: The [fmin..fmax] band from input is computed as if input is a FFT
      *       output, which under normal circumstances it should be.
      */
-    static RealWindow Crop(const RealWindow& input, double rate, double fmin, double fmax);
+    static BasicRealWindow<P> Crop(const BasicRealWindow<P>& input, double rate, double fmin, double fmax);
+
+    /**
+     * Crop a real, scaled output of the FFT into a caller provided window,
+     * which must have exactly the size of the cropped band.
+     */
+    static void Crop(std::span<const P> input, double rate, double fmin, double fmax, std::span<P> output);
+};
+
+/* FFT for the default, double precision pipeline */
+using FFT = BasicFFT<double>;
+
+/**
+ * Precomputed resampling of real, scaled FFT output windows to display width.
+ * The source bins and weights of each output value only depend on the
+ * geometry, so they are computed once and every window is then resampled in a
+ * single pass.
+ *
+ * Lanczos resampling (see BasicFFT::Resample()) uses at most a fixed number
+ * of multiply-accumulates per output value, vectorized across neighbouring
+ * output values, but when downsampling it only looks
+ * at the bins closest to each output value. Pooling reductions assign every
+ * bin in the displayed band to exactly one output value, so no signal is
+ * skipped.
+ * @tparam P Precision of windows (float or double).
+ */
+template <class P>
+class BasicResamplePlan {
+private:
+    /* Lanczos kernel size and resulting number of taps for each output value */
+    static constexpr std::size_t LANCZOS_A = 3;
+    static constexpr std::size_t TAP_COUNT = 2 * LANCZOS_A;
+
+    std::size_t input_size_;
+    std::size_t output_size_;
+    FrequencyReduction reduction_;
+
+    /* Lanczos resampling; the taps of an output value are consecutive input bins, and taps outside of input are
+     * dropped, so output values near the edges have fewer */
+    std::vector<std::size_t> first_bins_;   /* first input bin of each output value (shared with pooling) */
+    std::vector<std::size_t> tap_counts_;   /* number of taps of each output value, at most TAP_COUNT */
+    std::vector<double> weights_;           /* weight of tap t of output value j at t * width + j, zero if unused */
+    std::vector<double> weight_sums_;       /* sum of weights, for each output value */
+    std::size_t full_begin_;                /* range of output values that have all TAP_COUNT taps */
+    std::size_t full_end_;
+
+    /* pooling */
+    std::vector<std::size_t> bin_counts_;   /* number of input bins of each output value */
+
+public:
+    BasicResamplePlan() = delete;
+
+    /**
+     * @param input_size Size of input windows.
+     * @param rate Sampling rate of input.
+     * @param width Desired output width.
+     * @param fmin Frequency lower bound (from input).
+     * @param fmax Frequency upper bound (from input).
+     * @param reduction Method of reducing input bins to output values.
+     */
+    BasicResamplePlan(std::size_t input_size, double rate, std::size_t width, double fmin, double fmax,
+                      FrequencyReduction reduction = FrequencyReduction::kLanczos);
+
+    /**
+     * Resample a window.
+     * @param input Real window, values between [0..1], of the planned size.
+     * @param output Window that receives the resampled values, clamped to
+     *               [0..1], of the planned width.
+     * @param level Kernel to use for Lanczos resampling; levels the CPU does
+     *              not support fall back to the best supported one. All
+     *              kernels compute the same values.
+     */
+    void Apply(std::span<const P> input, std::span<P> output, SimdLevel level) const;
+
+    /**
+     * Resample a window, using the best kernel supported by the running CPU.
+     */
+    void Apply(std::span<const P> input, std::span<P> output) const
+    {
+        static const SimdLevel level = GetSupportedSimdLevel();
+        this->Apply(input, output, level);
+    }
+
+    auto GetInputSize() const { return input_size_; }
+    auto GetOutputSize() const { return output_size_; }
+    auto GetReduction() const { return reduction_; }
 };
 
+/* Resample plan for the default, double precision pipeline */
+using ResamplePlan = BasicResamplePlan<double>;
+
 #endif
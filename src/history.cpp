@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "history.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+History::History(std::size_t width, std::size_t chunk_size)
+    : width_(width), row_count_(0), released_chunks_(0)
+{
+    if (width == 0) {
+        throw std::runtime_error("history width must be positive");
+    }
+    this->rows_per_chunk_ = std::max<std::size_t>(1, chunk_size / (width * sizeof(ValueType)));
+}
+
+std::vector<History::ValueType>&
+History::GetTailChunk()
+{
+    if (this->row_count_ % this->rows_per_chunk_ == 0) {
+        this->chunks_.emplace_back();
+        this->chunks_.back().reserve(this->rows_per_chunk_ * this->width_);
+    }
+    return this->chunks_.back();
+}
+
+void
+History::AddRow(std::span<const double> values)
+{
+    if (values.size() != this->width_) {
+        throw std::runtime_error("row size must match history width");
+    }
+
+    constexpr double scale = std::numeric_limits<ValueType>::max();
+    auto& chunk = this->GetTailChunk();
+    for (auto value : values) {
+        value = std::isnan(value) ? 0.0 : std::clamp(value, 0.0, 1.0);
+        chunk.push_back(static_cast<ValueType>(value * scale + 0.5));
+    }
+    this->row_count_++;
+}
+
+void
+History::Append(const History& other)
+{
+    if (other.width_ != this->width_) {
+        throw std::runtime_error("history widths differ");
+    }
+
+    for (std::size_t i = 0; i < other.row_count_; i++) {
+        auto row = other.GetRow(i);
+        auto& chunk = this->GetTailChunk();
+        chunk.insert(chunk.end(), row.begin(), row.end());
+        this->row_count_++;
+    }
+}
+
+std::span<const History::ValueType>
+History::GetRow(std::size_t index) const
+{
+    if (index >= this->row_count_) {
+        throw std::runtime_error("history row index out of range");
+    }
+    if (index < this->GetFirstRowIndex()) {
+        throw std::runtime_error("history row was released");
+    }
+
+    const auto& chunk = this->chunks_[index / this->rows_per_chunk_ - this->released_chunks_];
+    assert(chunk.size() >= ((index % this->rows_per_chunk_) + 1) * this->width_);
+    return std::span<const ValueType>(chunk).subspan((index % this->rows_per_chunk_) * this->width_, this->width_);
+}
+
+void
+History::ReleaseRowsBefore(std::size_t index)
+{
+    /* only full chunks qualify, so the chunk receiving the next row is never released */
+    index = std::min(index, this->row_count_);
+    while (!this->chunks_.empty() && ((this->released_chunks_ + 1) * this->rows_per_chunk_ <= index)) {
+        this->chunks_.pop_front();
+        this->released_chunks_++;
+    }
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _HISTORY_HPP_
+#define _HISTORY_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+/**
+ * History of displayed windows, kept until the spectrogram is rendered.
+ *
+ * Values in the [0..1] domain are quantized to 16 bits (half the size of an
+ * RGBA pixel) and stored in an arena of fixed size chunks, each holding a
+ * number of contiguous rows, so adding a row never moves stored ones. The
+ * oldest chunks can be released once their rows are no longer needed.
+ */
+class History {
+public:
+    /* type of stored values; 0 is 0.0 and the maximum is 1.0 */
+    using ValueType = uint16_t;
+
+private:
+    std::size_t width_;                         /* number of values in a row */
+    std::size_t rows_per_chunk_;                /* number of rows in a chunk */
+    std::size_t row_count_;                     /* number of rows added */
+    std::size_t released_chunks_;               /* number of chunks released from the front */
+    std::deque<std::vector<ValueType>> chunks_;
+
+    /**
+     * @return Chunk that receives the next row; a new one is started if the
+     *         last one is full.
+     */
+    std::vector<ValueType>& GetTailChunk();
+
+public:
+    /* default chunk size, in bytes */
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+    History() = delete;
+
+    /**
+     * @param width Number of values in a row.
+     * @param chunk_size Size of a chunk, in bytes; a chunk holds at least
+     *                   one row.
+     */
+    explicit History(std::size_t width, std::size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+    /**
+     * Quantize and append a row.
+     * @param values Values in the [0..1] domain, width of them; values
+     *               outside of the domain are clamped and NaNs are stored
+     *               as 0.0.
+     */
+    void AddRow(std::span<const double> values);
+
+    /**
+     * Append all rows of another history.
+     * @param other History of the same width.
+     */
+    void Append(const History& other);
+
+    /**
+     * @param index Index of row, in order of addition.
+     * @return View of the quantized values of the row.
+     */
+    std::span<const ValueType> GetRow(std::size_t index) const;
+
+    /**
+     * Release the storage of rows that are no longer needed. Only whole
+     * chunks are released, so some of the rows may be kept; rows keep their
+     * indices, and released rows can no longer be retrieved.
+     * @param index Index of the oldest row still needed.
+     */
+    void ReleaseRowsBefore(std::size_t index);
+
+    /**
+     * @return Index of the oldest row that can still be retrieved.
+     */
+    std::size_t GetFirstRowIndex() const { return released_chunks_ * rows_per_chunk_; }
+
+    auto GetWidth() const { return width_; }
+    auto GetRowCount() const { return row_count_; }
+};
+
+#endif
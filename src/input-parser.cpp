@@ -5,81 +5,136 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 #include "input-parser.hpp"
+#include "sample-conversion.hpp"
 
+#include <algorithm>
 #include <cassert>
 
-InputParser::InputParser(double prescale, bool is_complex) : prescale_factor_(prescale), is_complex_(is_complex)
+template <class P>
+BasicInputParser<P>::BasicInputParser(double prescale, bool is_complex)
+    : prescale_factor_(prescale), is_complex_(is_complex), capacity_(0), head_(0), count_(0)
 {
 }
 
+template <class P>
+void
+BasicInputParser<P>::Reserve(std::size_t count)
+{
+    if (count <= this->capacity_) {
+        return;
+    }
+
+    /* grow geometrically, so that steady state input settles on a fixed capacity */
+    std::size_t capacity = std::max<std::size_t>(count, this->capacity_ * 2);
+    std::vector<ValueType> values(capacity * 2);
+
+    /* linearize buffered values at the start of the new ring, and mirror them */
+    auto buffered = this->PeekValues(this->count_);
+    std::copy(buffered.begin(), buffered.end(), values.begin());
+    std::copy(buffered.begin(), buffered.end(), values.begin() + capacity);
+
+    this->values_ = std::move(values);
+    this->capacity_ = capacity;
+    this->head_ = 0;
+}
+
+template <class P>
 std::size_t
-InputParser::GetBufferedValueCount() const
+BasicInputParser<P>::GetBufferedValueCount() const
 {
-    return values_.size();
+    return this->count_;
 }
 
-std::vector<Complex>
-InputParser::PeekValues(std::size_t count) const
+template <class P>
+std::span<const typename BasicInputParser<P>::ValueType>
+BasicInputParser<P>::PeekValues(std::size_t count) const
 {
-    count = std::min<std::size_t>(count, this->values_.size());
-    if (count == 0) {
-        return std::vector<Complex>();
-    }
-    return std::vector<Complex> (this->values_.begin(), this->values_.begin() + count);
+    count = std::min<std::size_t>(count, this->count_);
+    return std::span<const ValueType>(this->values_.data() + this->head_, count);
 }
 
+template <class P>
 void
-InputParser::RemoveValues(std::size_t count)
+BasicInputParser<P>::RemoveValues(std::size_t count)
 {
-    count = std::min<std::size_t>(count, this->values_.size());
+    count = std::min<std::size_t>(count, this->count_);
     if (count > 0) {
-        this->values_.erase(this->values_.begin(), this->values_.begin() + count);
+        this->head_ = (this->head_ + count) % this->capacity_;
+        this->count_ -= count;
     }
 }
 
-std::unique_ptr<InputParser>
-InputParser::Build(DataType dtype, double prescale, bool is_complex)
+template <class P>
+std::size_t
+BasicInputParser<P>::ParseBlock(std::span<const char> block)
+{
+    std::size_t incoming = block.size() / this->GetDataTypeSize();
+    this->Reserve(this->count_ + incoming);
+
+    /* parse in place, right after the buffered values; since everything fits in the ring, this region is
+     * contiguous in the mirrored storage */
+    std::size_t start = this->head_ + this->count_;
+    auto region = std::span<ValueType>(this->values_).subspan(start, incoming);
+    std::size_t count = this->ParseBlock(block, region);
+    assert(count == incoming);
+
+    /* mirror the newly parsed values; those in the lower half go up, those in the upper half go down */
+    std::size_t split = std::clamp(this->capacity_, start, start + count);
+    std::copy(this->values_.begin() + start, this->values_.begin() + split,
+              this->values_.begin() + start + this->capacity_);
+    std::copy(this->values_.begin() + split, this->values_.begin() + start + count,
+              this->values_.begin() + split - this->capacity_);
+
+    this->count_ += count;
+    return count;
+}
+
+template <class P>
+std::unique_ptr<BasicInputParser<P>>
+BasicInputParser<P>::Build(DataType dtype, double prescale, bool is_complex)
 {
     if (dtype == DataType::kSignedInt8) {
-        return std::make_unique<IntegerInputParser<int8_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<int8_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kSignedInt16) {
-        return std::make_unique<IntegerInputParser<int16_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<int16_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kSignedInt32) {
-        return std::make_unique<IntegerInputParser<int32_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<int32_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kSignedInt64) {
-        return std::make_unique<IntegerInputParser<int64_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<int64_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kUnsignedInt8) {
-        return std::make_unique<IntegerInputParser<uint8_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<uint8_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kUnsignedInt16) {
-        return std::make_unique<IntegerInputParser<uint16_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<uint16_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kUnsignedInt32) {
-        return std::make_unique<IntegerInputParser<uint32_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<uint32_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kUnsignedInt64) {
-        return std::make_unique<IntegerInputParser<uint64_t>>(prescale, is_complex);
+        return std::make_unique<IntegerInputParser<uint64_t, P>>(prescale, is_complex);
     } else if (dtype == DataType::kFloat32) {
-        return std::make_unique<FloatInputParser<float>>(prescale, is_complex);
+        return std::make_unique<FloatInputParser<float, P>>(prescale, is_complex);
     } else if (dtype == DataType::kFloat64) {
-        return std::make_unique<FloatInputParser<double>>(prescale, is_complex);
+        return std::make_unique<FloatInputParser<double, P>>(prescale, is_complex);
     } else {
         throw std::runtime_error("unknown datatype");
     }
 }
 
-template <class T>
-IntegerInputParser<T>::IntegerInputParser(double prescale, bool is_complex) : InputParser(prescale, is_complex)
+template <class T, class P>
+IntegerInputParser<T, P>::IntegerInputParser(double prescale, bool is_complex)
+    : BasicInputParser<P>(prescale, is_complex)
 {
 }
 
-template <class T>
+template <class T, class P>
 std::size_t
-IntegerInputParser<T>::GetDataTypeSize() const
+IntegerInputParser<T, P>::GetDataTypeSize() const
 {
     return sizeof(T) * (this->is_complex_ ? 2 : 1);
 }
 
-template <class T>
+template <class T, class P>
 std::size_t
-IntegerInputParser<T>::ParseBlock(const std::vector<char> &block)
+IntegerInputParser<T, P>::ParseBlock(std::span<const char> block,
+                                 std::span<typename BasicInputParser<P>::ValueType> output) const
 {
     /* this function assumes well structured blocks */
     std::size_t item_size = (this->is_complex_ ? 2 : 1) * sizeof(T);
@@ -88,41 +143,36 @@ IntegerInputParser<T>::ParseBlock(const std::vector<char> &block)
     }
 
     std::size_t count = block.size() / item_size;
+    if (output.size() < count) {
+        throw std::runtime_error("output window too small for block");
+    }
     const T *start = reinterpret_cast<const T *>(block.data());
 
-    /* parse one value at a time into complex target */
-    for (std::size_t i = 0; i < count; i ++) {
-        Complex value;
-        if (this->is_complex_) {
-            value = Complex(start[i * 2], start[i * 2 + 1]);
-        } else {
-            value = Complex(start[i], 0.0f);
-        }
-
-        /* normalize to domain limit */
-        value /= (double)std::numeric_limits<T>::max();
-        value *= this->prescale_factor_;
-        this->values_.emplace_back(value);
-    }
+    /* normalize to domain limit and prescale, in one go */
+    double scale = this->prescale_factor_ / (double)std::numeric_limits<T>::max();
+    ConvertSamples<T, P>(std::span<const T>(start, count * (this->is_complex_ ? 2 : 1)), this->is_complex_, scale,
+                      output);
 
     return count;
 }
 
-template <class T>
-FloatInputParser<T>::FloatInputParser(double prescale, bool is_complex) : InputParser(prescale, is_complex)
+template <class T, class P>
+FloatInputParser<T, P>::FloatInputParser(double prescale, bool is_complex)
+    : BasicInputParser<P>(prescale, is_complex)
 {
 }
 
-template <class T>
+template <class T, class P>
 std::size_t
-FloatInputParser<T>::GetDataTypeSize() const
+FloatInputParser<T, P>::GetDataTypeSize() const
 {
     return sizeof(T) * (this->is_complex_ ? 2 : 1);
 }
 
-template <class T>
+template <class T, class P>
 std::size_t
-FloatInputParser<T>::ParseBlock(const std::vector<char> &block)
+FloatInputParser<T, P>::ParseBlock(std::span<const char> block,
+                                 std::span<typename BasicInputParser<P>::ValueType> output) const
 {
     /* this function assumes well structured blocks */
     std::size_t item_size = (this->is_complex_ ? 2 : 1) * sizeof(T);
@@ -131,36 +181,40 @@ FloatInputParser<T>::ParseBlock(const std::vector<char> &block)
     }
 
     std::size_t count = block.size() / item_size;
+    if (output.size() < count) {
+        throw std::runtime_error("output window too small for block");
+    }
     const T *start = reinterpret_cast<const T *>(block.data());
 
-    /* parse one value at a time into complex target */
-    for (std::size_t i = 0; i < count; i ++) {
-        Complex value;
-        /* remove NaNs */
-        if (this->is_complex_) {
-            value = Complex(std::isnan(start[i * 2]) ? 0.0f : start[i * 2],
-                            std::isnan(start[i * 2 + 1]) ? 0.0f : start[i * 2 + 1]);
-        } else {
-            value = Complex(std::isnan(start[i]) ? 0.0f : start[i], 0.0f);
-        }
-
-        /* prescale */
-        value *= this->prescale_factor_;
-        this->values_.emplace_back(value);
-    }
+    /* remove NaNs and prescale */
+    ConvertSamples<T, P>(std::span<const T>(start, count * (this->is_complex_ ? 2 : 1)), this->is_complex_,
+                      this->prescale_factor_, output);
 
     return count;
 }
 
-template class IntegerInputParser<int8_t>;
-template class IntegerInputParser<int16_t>;
-template class IntegerInputParser<int32_t>;
-template class IntegerInputParser<int64_t>;
-
-template class IntegerInputParser<uint8_t>;
-template class IntegerInputParser<uint16_t>;
-template class IntegerInputParser<uint32_t>;
-template class IntegerInputParser<uint64_t>;
-
-template class FloatInputParser<float>;
-template class FloatInputParser<double>;
+template class BasicInputParser<float>;
+template class BasicInputParser<double>;
+
+template class IntegerInputParser<int8_t, float>;
+template class IntegerInputParser<int16_t, float>;
+template class IntegerInputParser<int32_t, float>;
+template class IntegerInputParser<int64_t, float>;
+template class IntegerInputParser<int8_t, double>;
+template class IntegerInputParser<int16_t, double>;
+template class IntegerInputParser<int32_t, double>;
+template class IntegerInputParser<int64_t, double>;
+
+template class IntegerInputParser<uint8_t, float>;
+template class IntegerInputParser<uint16_t, float>;
+template class IntegerInputParser<uint32_t, float>;
+template class IntegerInputParser<uint64_t, float>;
+template class IntegerInputParser<uint8_t, double>;
+template class IntegerInputParser<uint16_t, double>;
+template class IntegerInputParser<uint32_t, double>;
+template class IntegerInputParser<uint64_t, double>;
+
+template class FloatInputParser<float, float>;
+template class FloatInputParser<double, float>;
+template class FloatInputParser<float, double>;
+template class FloatInputParser<double, double>;
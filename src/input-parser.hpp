@@ -10,6 +10,7 @@
 #include <vector>
 #include <complex>
 #include <memory>
+#include <span>
 
 /**
  * Input data type
@@ -32,38 +33,72 @@ enum class DataType {
     kFloat64
 };
 
-/* Complex type that we normalize everything to */
+/**
+ * Precision of the processing pipeline
+ */
+enum class Precision {
+    kSingle,
+    kDouble
+};
+
+/* Window of real numbers, of a given precision */
+template <class P>
+using BasicRealWindow = std::vector<P>;
+
+/* Window of complex numbers, of a given precision */
+template <class P>
+using BasicComplexWindow = std::vector<std::complex<P>>;
+
+/* Complex type that we normalize everything to, in double precision */
 typedef std::complex<double> Complex;
 
 /* Window of real numbers */
-typedef std::vector<double> RealWindow;
+typedef BasicRealWindow<double> RealWindow;
 
 /* Window of complex numbers */
-typedef std::vector<Complex> ComplexWindow;
+typedef BasicComplexWindow<double> ComplexWindow;
 
 /**
  * Input parser base class
+ * @tparam P Precision of parsed values (float or double).
  */
-class InputParser {
+template <class P>
+class BasicInputParser {
+public:
+    /* type of parsed values */
+    using ValueType = std::complex<P>;
+
 protected:
     double prescale_factor_;        /* factor that is applied before further processing */
     bool is_complex_;               /* input is complex? */
-    std::vector<Complex> values_;   /* parsed values */
 
-    InputParser() = delete;
+    /* parsed values, stored in a mirrored ring: element i is also stored at i + capacity_, so any
+     * run of at most capacity_ buffered values starting at head_ is contiguous in memory */
+    std::vector<ValueType> values_; /* 2 * capacity_ elements */
+    std::size_t capacity_;          /* maximum number of buffered values before growing */
+    std::size_t head_;              /* index of oldest buffered value, in [0, capacity_) */
+    std::size_t count_;             /* number of buffered values */
+
+    BasicInputParser() = delete;
 
     /**
      * @param prescale Prescale factor, applied after parsing.
      * @param is_complex If true, input is treated as complex-typed. Two input
      *                   values will be read for each output value.
      */
-    explicit InputParser(double prescale, bool is_complex);
+    explicit BasicInputParser(double prescale, bool is_complex);
+
+    /**
+     * Grows the ring, if needed, so that it can buffer at least count values.
+     * @param count Number of values that must fit in the ring.
+     */
+    void Reserve(std::size_t count);
 
 public:
-    InputParser(const InputParser &c) = delete;
-    InputParser(InputParser &&) = delete;
-    InputParser & operator=(const InputParser&) = delete;
-    virtual ~InputParser() = default;
+    BasicInputParser(const BasicInputParser &c) = delete;
+    BasicInputParser(BasicInputParser &&) = delete;
+    BasicInputParser & operator=(const BasicInputParser&) = delete;
+    virtual ~BasicInputParser() = default;
 
     /**
      * Factory method for retrieving a suitable parser.
@@ -73,7 +108,7 @@ public:
      *                   values will be read for each output value.
      * @return New Parser object.
      */
-    static std::unique_ptr<InputParser> Build(DataType dtype, double prescale, bool is_complex);
+    static std::unique_ptr<BasicInputParser> Build(DataType dtype, double prescale, bool is_complex);
 
     /**
      * @return The number of values that have been parsed, but not yet retrieved.
@@ -83,9 +118,10 @@ public:
     /**
      * Retrieves, without removing, from the parsed (buffered) value array.
      * @param count Number of values to retrieve.
-     * @return
+     * @return View of at most count values, valid until the next call to
+     *         ParseBlock() or RemoveValues().
      */
-    std::vector<Complex> PeekValues(std::size_t count) const;
+    std::span<const ValueType> PeekValues(std::size_t count) const;
 
     /**
      * Removes values from the parsed (buffered) values array.
@@ -94,12 +130,26 @@ public:
     void RemoveValues(std::size_t count);
 
     /**
-     * Parses a block of bytes.
-     * @param block Block of bytes that must have a size that is a multiple of
-     *              the underlying data type size (or twice that for complex).
+     * Parses a block of bytes and appends the values to the parsed (buffered)
+     * value array.
+     * @param block View of a block of bytes that must have a size that is a
+     *              multiple of the underlying data type size (or twice that for
+     *              complex).
+     * @return Number of parsed values.
+     */
+    std::size_t ParseBlock(std::span<const char> block);
+
+    /**
+     * Parses a block of bytes straight into a caller provided window, bypassing
+     * the parsed (buffered) value array.
+     * @param block View of a block of bytes that must have a size that is a
+     *              multiple of the underlying data type size (or twice that for
+     *              complex).
+     * @param output Window that receives the parsed values; must be able to
+     *               hold at least block.size() / GetDataTypeSize() values.
      * @return Number of parsed values.
      */
-    virtual std::size_t ParseBlock(const std::vector<char> &block) = 0;
+    virtual std::size_t ParseBlock(std::span<const char> block, std::span<ValueType> output) const = 0;
 
     /**
      * @return Size of the underlying data type (or twice for complex).
@@ -122,16 +172,23 @@ public:
     virtual bool IsComplex() const { return is_complex_; };
 };
 
+/* Input parser for the default, double precision pipeline */
+using InputParser = BasicInputParser<double>;
+
 /**
  * Specialized parser for integer input.
+ * @tparam T Input data type.
+ * @tparam P Precision of parsed values.
  */
-template <class T>
-class IntegerInputParser : public InputParser {
+template <class T, class P = double>
+class IntegerInputParser : public BasicInputParser<P> {
 public:
     IntegerInputParser() = delete;
     explicit IntegerInputParser(double prescale, bool is_complex);
 
-    std::size_t ParseBlock(const std::vector<char> &block) override;
+    using BasicInputParser<P>::ParseBlock;
+    std::size_t ParseBlock(std::span<const char> block,
+                           std::span<typename BasicInputParser<P>::ValueType> output) const override;
 
     std::size_t GetDataTypeSize() const override;
     bool IsSigned() const override { return std::numeric_limits<T>::is_signed; };
@@ -140,14 +197,18 @@ public:
 
 /**
  * Specialized parser for floating point input.
+ * @tparam T Input data type.
+ * @tparam P Precision of parsed values.
  */
-template <class T>
-class FloatInputParser : public InputParser {
+template <class T, class P = double>
+class FloatInputParser : public BasicInputParser<P> {
 public:
     FloatInputParser() = delete;
     explicit FloatInputParser(double prescale, bool is_complex);
 
-    std::size_t ParseBlock(const std::vector<char> &block) override;
+    using BasicInputParser<P>::ParseBlock;
+    std::size_t ParseBlock(std::span<const char> block,
+                           std::span<typename BasicInputParser<P>::ValueType> output) const override;
 
     std::size_t GetDataTypeSize() const override;
     bool IsSigned() const override { return true; };
@@ -7,8 +7,16 @@
 
 #include "input-reader.hpp"
 
+#include <algorithm>
 #include <csignal>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 InputReader::InputReader(std::istream * stream, std::size_t block_size_bytes)
     : stream_(stream), block_size_bytes_(block_size_bytes)
@@ -21,9 +29,18 @@ InputReader::InputReader(std::istream * stream, std::size_t block_size_bytes)
     }
 }
 
+InputReader::InputReader(std::size_t block_size_bytes)
+    : stream_(nullptr), block_size_bytes_(block_size_bytes)
+{
+    if (block_size_bytes == 0) {
+        throw std::runtime_error("block size in bytes must be positive");
+    }
+}
+
 SyncInputReader::SyncInputReader(std::istream * stream, std::size_t block_size_bytes)
     : InputReader(stream, block_size_bytes)
 {
+    this->buffer_.resize(block_size_bytes);
 }
 
 bool
@@ -33,7 +50,7 @@ SyncInputReader::ReachedEOF() const
     return this->stream_->eof();
 }
 
-std::optional<std::vector<char>>
+std::optional<std::span<const char>>
 SyncInputReader::GetBlock()
 {
     auto buffer = this->GetBuffer();
@@ -46,24 +63,101 @@ SyncInputReader::GetBlock()
     }
 }
 
-std::vector<char>
+std::span<const char>
 SyncInputReader::GetBuffer()
 {
-    std::vector<char> local_buffer;
-    local_buffer.resize(this->block_size_bytes_);
-
     assert(this->stream_ != nullptr);
-    this->stream_->read(local_buffer.data(), this->block_size_bytes_);
-    return std::vector<char>(local_buffer.data(), local_buffer.data() + this->stream_->gcount());
+    assert(this->buffer_.size() == this->block_size_bytes_);
+    this->stream_->read(this->buffer_.data(), this->block_size_bytes_);
+    return std::span<const char>(this->buffer_.data(), this->stream_->gcount());
 }
 
-AsyncInputReader::AsyncInputReader(std::istream * stream, std::size_t block_size_bytes)
-    : InputReader(stream, block_size_bytes)
+MmapInputReader::MmapInputReader(const std::string& filename, std::size_t block_size_bytes)
+    : InputReader(block_size_bytes), mapping_(nullptr), size_(0), offset_(0)
+{
+    /* pipes, character devices and the like cannot be mapped; check before opening, as opening a named pipe
+     * pairs with its writer, which would then lose its reader when we close it for the caller to reopen */
+    struct stat sb;
+    if (stat(filename.c_str(), &sb) != 0) {
+        throw std::runtime_error("cannot open input file " + filename);
+    }
+    if (!S_ISREG(sb.st_mode)) {
+        throw std::runtime_error("input file " + filename + " is not a regular file");
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open input file " + filename);
+    }
+
+    /* the path may have been replaced in the meantime */
+    if (fstat(fd, &sb) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot stat input file " + filename);
+    }
+    if (!S_ISREG(sb.st_mode)) {
+        close(fd);
+        throw std::runtime_error("input file " + filename + " is not a regular file");
+    }
+    this->size_ = sb.st_size;
+
+    /* zero-length mappings are not allowed; an empty file is simply at EOF */
+    if (this->size_ > 0) {
+        void *addr = mmap(nullptr, this->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("cannot map input file " + filename + ": " + std::strerror(errno));
+        }
+        this->mapping_ = reinterpret_cast<const char *>(addr);
+
+        /* we only ever walk the file front to back; let the kernel read ahead aggressively */
+        madvise(addr, this->size_, MADV_SEQUENTIAL);
+    }
+
+    /* the mapping holds its own reference to the file */
+    close(fd);
+}
+
+MmapInputReader::~MmapInputReader()
 {
-    this->buffer_ = new char[block_size_bytes];
-    assert(this->buffer_ != nullptr);
-    this->bytes_in_buffer_ = 0;
+    if (this->mapping_ != nullptr) {
+        munmap(const_cast<char *>(this->mapping_), this->size_);
+        this->mapping_ = nullptr;
+    }
+}
 
+bool
+MmapInputReader::ReachedEOF() const
+{
+    /* trailing bytes that do not form a complete block are discarded, same as SyncInputReader */
+    return (this->size_ - this->offset_) < this->block_size_bytes_;
+}
+
+std::optional<std::span<const char>>
+MmapInputReader::GetBlock()
+{
+    auto buffer = this->GetBuffer();
+    if (buffer.size() == this->block_size_bytes_) {
+        return buffer;
+    } else {
+        assert(this->ReachedEOF());
+        return {};
+    }
+}
+
+std::span<const char>
+MmapInputReader::GetBuffer()
+{
+    assert(this->offset_ <= this->size_);
+    auto count = std::min<std::size_t>(this->block_size_bytes_, this->size_ - this->offset_);
+    std::span<const char> view(this->mapping_ + this->offset_, count);
+    this->offset_ += count;
+    return view;
+}
+
+AsyncInputReader::AsyncInputReader(std::istream * stream, std::size_t block_size_bytes, std::size_t queue_depth)
+    : InputReader(stream, block_size_bytes), queue_(block_size_bytes, queue_depth), holding_block_(false)
+{
     /* start reader thread */
     this->running_ = true;
     this->reader_thread_ = std::thread(&AsyncInputReader::Read, this);
@@ -72,65 +166,37 @@ AsyncInputReader::AsyncInputReader(std::istream * stream, std::size_t block_size
 AsyncInputReader::~AsyncInputReader()
 {
     /* end reader thread */
-    this->mutex_.lock();
     this->running_ = false;
-    this->mutex_.unlock();
 
     /* send SIGINT so we interrupt any blocking reads */
     pthread_kill(this->reader_thread_.native_handle(), SIGINT);
     this->reader_thread_.join();
-
-    /* dealloc buffer */
-    if (this->buffer_ != nullptr) {
-        delete[] this->buffer_;
-        this->buffer_ = nullptr;
-    }
 }
 
 void
 AsyncInputReader::Read()
 {
-    char *local_buffer = new char[this->block_size_bytes_];
-    assert(local_buffer != nullptr);
-
-    while (true) {
-        /* find out how much we need to populate in the buffer */
-        this->mutex_.lock();
-        long long int to_read = this->block_size_bytes_ - this->bytes_in_buffer_;
-        if (!this->running_) {
-            this->mutex_.unlock();
-            break;
-        }
-        this->mutex_.unlock();
-        assert(to_read >= 0);
-
-        /* yield execution if nothing to read */
-        if (to_read == 0) {
+    while (this->running_) {
+        /* find a free block in the queue */
+        auto block = this->queue_.AcquireWrite();
+        if (!block.has_value()) {
+            /* consumer is lagging behind by a full queue; wait for it */
             std::this_thread::yield();
             continue;
         }
 
-        /* blocking read */
+        /* blocking read, straight into the queue */
         assert(this->stream_ != nullptr);
-        this->stream_->read(local_buffer, to_read);
-        if (this->stream_->fail()) {
+        assert(block->size() == this->block_size_bytes_);
+        this->stream_->read(block->data(), this->block_size_bytes_);
+        if (this->stream_->fail() || !this->running_) {
             break;
         } else {
-            assert(this->stream_->gcount() == to_read);
+            assert(static_cast<std::size_t>(this->stream_->gcount()) == this->block_size_bytes_);
         }
 
-        /* write to buffer */
-        this->mutex_.lock();
-        if (!this->running_) {
-            this->mutex_.unlock();
-            break;
-        }
-        assert(to_read + this->bytes_in_buffer_ <= this->block_size_bytes_);
-        auto k = to_read;
-        assert(this->buffer_ != nullptr);
-        for (volatile char *a = local_buffer, *b = this->buffer_ + this->bytes_in_buffer_; k > 0; *b++ = *a++, k--) /* nop */;
-        this->bytes_in_buffer_ = this->bytes_in_buffer_ + to_read;
-        this->mutex_.unlock();
+        /* hand over to consumer */
+        this->queue_.Push();
     }
 }
 
@@ -142,26 +208,30 @@ AsyncInputReader::ReachedEOF() const
     return false;
 }
 
-std::optional<std::vector<char>>
+std::optional<std::span<const char>>
 AsyncInputReader::GetBlock()
 {
-    const std::lock_guard<std::mutex> lock(this->mutex_);
-    if (this->bytes_in_buffer_ < this->block_size_bytes_) {
-        return {};
+    auto buffer = this->GetBuffer();
+    if (buffer.size() == this->block_size_bytes_) {
+        return buffer;
     } else {
-        auto bcount = this->bytes_in_buffer_;
-        this->bytes_in_buffer_ = 0;
-        assert(this->buffer_);
-        return std::vector<char>(this->buffer_, this->buffer_ + bcount);
+        return {};
     }
 }
 
-std::vector<char>
+std::span<const char>
 AsyncInputReader::GetBuffer()
 {
-    const std::lock_guard<std::mutex> lock(this->mutex_);
-    assert(this->buffer_);
-    std::vector<char> wrapper(this->buffer_, this->buffer_ + this->bytes_in_buffer_);
-    this->bytes_in_buffer_ = 0;
-    return wrapper;
+    /* the previously handed out block is no longer in use */
+    if (this->holding_block_) {
+        this->queue_.Pop();
+        this->holding_block_ = false;
+    }
+
+    auto block = this->queue_.Front();
+    if (!block.has_value()) {
+        return {};
+    }
+    this->holding_block_ = true;
+    return *block;
 }
@@ -7,9 +7,13 @@
 #ifndef _INPUT_READER_HPP_
 #define _INPUT_READER_HPP_
 
+#include "slot-queue.hpp"
+
+#include <atomic>
 #include <istream>
-#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -23,9 +27,15 @@ protected:
 
     /**
      * Retrieves an internal buffer that may or may not be block sized.
-     * @return Buffer.
+     * @return View of the buffer, valid until the next call.
+     */
+    virtual std::span<const char> GetBuffer() = 0;
+
+    /**
+     * Constructor for readers that do not straddle a stream.
+     * @param block_size_bytes Block size in bytes.
      */
-    virtual std::vector<char> GetBuffer() = 0;
+    explicit InputReader(std::size_t block_size_bytes);
 
 public:
     InputReader() = delete;
@@ -46,52 +56,114 @@ public:
     virtual bool ReachedEOF() const = 0;
 
     /**
-     * @return A block of bytes, if such a block exists.
+     * @return A view of a block of bytes, if such a block exists.
+     *
+     * NOTE: The view is owned by the reader and is only valid until the next
+     *       call to GetBlock() or until the reader is destroyed.
      */
-    virtual std::optional<std::vector<char>> GetBlock() = 0;
+    virtual std::optional<std::span<const char>> GetBlock() = 0;
 };
 
 /**
  * Synchronous input reader specialization
  */
 class SyncInputReader : public InputReader {
+private:
+    std::vector<char> buffer_;  /* block sized buffer we read into */
+
 protected:
-    std::vector<char> GetBuffer() override;
+    std::span<const char> GetBuffer() override;
 
 public:
     SyncInputReader(std::istream * stream, std::size_t block_size_bytes);
 
     bool ReachedEOF() const override;
-    std::optional<std::vector<char>> GetBlock() override;
+    std::optional<std::span<const char>> GetBlock() override;
+};
+
+/**
+ * Memory mapped input reader specialization. Blocks are views straight into
+ * the mapping, so no reads or copies are performed.
+ */
+class MmapInputReader : public InputReader {
+private:
+    const char *mapping_;   /* start of mapped file */
+    std::size_t size_;      /* size of mapped file, in bytes */
+    std::size_t offset_;    /* offset of the next block */
+
+protected:
+    std::span<const char> GetBuffer() override;
+
+public:
+    /**
+     * @param filename Input file to map. Must be a regular file.
+     * @param block_size_bytes Block size in bytes.
+     */
+    MmapInputReader(const std::string& filename, std::size_t block_size_bytes);
+    ~MmapInputReader() override;
+
+    bool ReachedEOF() const override;
+    std::optional<std::span<const char>> GetBlock() override;
+
+    /**
+     * @return View of the whole mapped file, regardless of which blocks have
+     *         been retrieved.
+     */
+    std::span<const char> GetData() const { return std::span<const char>(mapping_, size_); }
+
+    /**
+     * @return Total number of complete blocks in the file.
+     */
+    std::size_t GetBlockCount() const { return size_ / block_size_bytes_; }
 };
 
 /**
  * Asynchronous input reader specialization.
+ *
+ * A reader thread fills a queue of blocks, so that short stalls of the
+ * consumer do not back up the input stream.
  */
 class AsyncInputReader : public InputReader {
 private:
-    /* buffer where we read up until one block */
-    volatile char *buffer_;
-    volatile std::size_t bytes_in_buffer_;
-
-    /* mutex for accessing buffer */
-    std::mutex mutex_;
+    /* queue of blocks read from the stream, but not yet consumed */
+    SlotQueue<char> queue_;
+    bool holding_block_;                /* consumer holds the front block of the queue */
 
     /* thread for reading from input stream */
     std::thread reader_thread_;
-    volatile bool running_;
+    std::atomic<bool> running_;
 
     void Read();
 
 protected:
-    std::vector<char> GetBuffer() override;
+    std::span<const char> GetBuffer() override;
 
 public:
-    AsyncInputReader(std::istream * stream, std::size_t block_size_bytes);
+    /**
+     * @param stream Input stream to use.
+     * @param block_size_bytes Block size in bytes.
+     * @param queue_depth Maximum number of blocks buffered between reader thread and consumer.
+     */
+    AsyncInputReader(std::istream * stream, std::size_t block_size_bytes, std::size_t queue_depth = 64);
     ~AsyncInputReader() override;
 
     bool ReachedEOF() const override; /* no EOF support is assumed in async input */
-    std::optional<std::vector<char>> GetBlock() override;
+    std::optional<std::span<const char>> GetBlock() override;
+
+    /**
+     * @return Number of times the reader thread found the queue full and had to wait.
+     */
+    std::size_t GetOverrunCount() const { return queue_.GetOverrunCount(); }
+
+    /**
+     * @return Maximum number of blocks that were buffered at any given time.
+     */
+    std::size_t GetHighWaterMark() const { return queue_.GetHighWaterMark(); }
+
+    /**
+     * @return Maximum number of blocks that can be buffered.
+     */
+    std::size_t GetQueueDepth() const { return queue_.GetDepth(); }
 };
 
 #endif
@@ -6,13 +6,16 @@
  */
 #include "live.hpp"
 
-#include <cassert>
-#include <cstring>
+#include <algorithm>
+#include <vector>
 
 LiveOutput::LiveOutput(const Configuration& conf)
     : width_(conf.GetWidth())
     , is_horizontal_(conf.IsHorizontal())
     , renderer_(conf.GetForLive(), conf.GetCount())
+    , window_dirty_(true)
+    , newest_window_(conf.GetWidth())
+    , has_new_window_(false)
 {
     auto width = conf.IsHorizontal() ? renderer_.GetHeight() : renderer_.GetWidth();
     auto height = conf.IsHorizontal() ? renderer_.GetWidth() : renderer_.GetHeight();
@@ -23,37 +26,25 @@ LiveOutput::LiveOutput(const Configuration& conf)
                          sf::Style::Close);
     this->window_.setFramerateLimit(0);
 
-    /* FFT area raw memory used to update the area texture */
-    this->fft_area_.resize(conf.GetWidth() * conf.GetCount() * 4); /* RGBA pixel array */
-
     /* render the live FFT area with a DC signal of zero */
     Render(); /* I don't have a good idea why this is needed, but I guess it has something to do with double buffering */
-    this->renderer_.RenderFFTArea(this->fft_area_);
+    this->renderer_.RenderFFTArea(std::vector<uint8_t>(conf.GetWidth() * conf.GetCount() * 4)); /* RGBA pixel array */
     this->renderer_.RenderLiveFFT(RealWindow(conf.GetWidth()));
 }
 
-std::vector<uint8_t>
-LiveOutput::AddWindow(const RealWindow& win_values)
+void
+LiveOutput::AddWindow(std::span<const double> win_values)
 {
-    auto window = this->renderer_.RenderLiveFFT(win_values);
-    std::size_t wlen_bytes = this->width_ * 4;
-    if (window.size() != wlen_bytes) {
+    if (win_values.size() != this->width_) {
         throw std::runtime_error("input window size differs from live window size");
     }
 
-    /* scroll down one window */
-    assert(this->fft_area_.size() >= wlen_bytes);
-    std::memmove(reinterpret_cast<void *>(this->fft_area_.data() + wlen_bytes),
-                 reinterpret_cast<const void *>(this->fft_area_.data()),
-                 fft_area_.size() - wlen_bytes);
-    /* copy new window */
-    std::memcpy(reinterpret_cast<void *>(this->fft_area_.data()),
-                reinterpret_cast<const void *>(window.data()),
-                wlen_bytes);
+    /* scroll down one window; only the texture row is uploaded here */
+    this->renderer_.ScrollFFTArea(win_values);
 
-    /* update renderer texture */
-    this->renderer_.RenderFFTArea(this->fft_area_);
-    return window;
+    /* older windows added during the same frame would be drawn over in the plot anyway */
+    std::copy(win_values.begin(), win_values.end(), this->newest_window_.begin());
+    this->has_new_window_ = true;
 }
 
 bool
@@ -61,6 +52,8 @@ LiveOutput::HandleEvents()
 {
     sf::Event event;
     while (this->window_.pollEvent(event)) {
+        /* window may have been uncovered or resized by the system; redraw it */
+        this->window_dirty_ = true;
         if ((event.type == sf::Event::Closed)
             || (event.type == sf::Event::KeyPressed
                 && event.key.code == sf::Keyboard::Escape)) {
@@ -73,8 +66,20 @@ LiveOutput::HandleEvents()
 void
 LiveOutput::Render()
 {
+    /* draw windows added since the last frame, plotting only the newest one */
+    if (this->has_new_window_) {
+        this->renderer_.RenderLiveFFT(this->newest_window_);
+        this->renderer_.DrawFFTArea();
+        this->has_new_window_ = false;
+    }
+
+    /* nothing new to present */
+    if (!this->window_dirty_ && !this->renderer_.IsCanvasDirty()) {
+        return;
+    }
+
     /* draw renderer output to window */
-    sf::Texture canvas_texture = this->renderer_.GetCanvas();
+    const sf::Texture& canvas_texture = this->renderer_.GetCanvas();
     sf::Sprite canvas_sprite(canvas_texture);
     if (this->is_horizontal_) {
         canvas_sprite.setRotation(-90.0f);
@@ -83,4 +88,5 @@ LiveOutput::Render()
 
     this->window_.draw(canvas_sprite);
     this->window_.display();
+    this->window_dirty_ = false;
 }
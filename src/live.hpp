@@ -24,9 +24,11 @@ private:
 
     /* live window */
     sf::RenderWindow window_;
+    bool window_dirty_;     /* true if window must be presented even if canvas did not change */
 
-    /* raw FFT history */
-    std::vector<uint8_t> fft_area_;
+    /* newest window added since the last render, plotted by the next one */
+    RealWindow newest_window_;
+    bool has_new_window_;
 
 public:
     LiveOutput() = delete;
@@ -42,11 +44,11 @@ public:
     LiveOutput(const Configuration& conf);
 
     /**
-     * Add a FFT window to the history and render it.
+     * Add a FFT window to the spectrogram area. Drawing is deferred to
+     * Render(), which plots only the newest window added since the last call.
      * @param win_values Window values, real, scaled.
-     * @return A copy of the colorized window that is rendered.
      */
-    std::vector<uint8_t> AddWindow(const RealWindow& win_values);
+    void AddWindow(std::span<const double> win_values);
 
     /**
      * Handle window events.
@@ -55,7 +57,8 @@ public:
     bool HandleEvents();
 
     /**
-     * Render live window.
+     * Render live window. Does nothing if no window was added and no window
+     * event arrived since the last call.
      */
     void Render();
 };
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "pixel-rotation.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPECGRAM_X86_KERNELS
+#endif
+
+/* side of the square tiles the image is processed in, in pixels; a tile of input and its rotated output (64 KiB
+ * each) stay in L2 cache while being transposed */
+static constexpr std::size_t TILE_SIZE = 128;
+
+/* the transpose is bound by memory access; 8x8 AVX2 blocks were measured to be no faster than 4x4 SSE2 blocks (and
+ * slower on power of two strides, where their eight rows map to the same cache sets), so AVX2 uses the latter */
+
+/*
+ * All kernels rotate a block whose top-left input pixel is at in, with input rows in_stride pixels apart. The
+ * rotated pixel lands at out, and rotated rows are out_stride pixels apart, going *up* in the output (input
+ * column x + k lands on the row k rows above that of column x).
+ */
+
+/**
+ * Scalar kernel, for any block size; also used for tile edges.
+ * @param cols Number of columns in block.
+ * @param rows Number of rows in block.
+ */
+static void
+rotate_scalar(const uint32_t *in, std::size_t in_stride, std::size_t cols, std::size_t rows,
+              uint32_t *out, std::size_t out_stride)
+{
+    for (std::size_t c = 0; c < cols; c++) {
+        auto o = out - c * out_stride;
+        for (std::size_t r = 0; r < rows; r++) {
+            o[r] = in[r * in_stride + c];
+        }
+    }
+}
+
+#ifdef SPECGRAM_X86_KERNELS
+
+/**
+ * SSE2 kernel, 4x4 pixel blocks.
+ */
+static inline void
+rotate4_sse2(const uint32_t *in, std::size_t in_stride, uint32_t *out, std::size_t out_stride)
+{
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + in_stride));
+    __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * in_stride));
+    __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 3 * in_stride));
+
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);  /* r0[0] r1[0] r0[1] r1[1] */
+    __m128i t1 = _mm_unpackhi_epi32(r0, r1);  /* r0[2] r1[2] r0[3] r1[3] */
+    __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi64(t0, t2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out - out_stride), _mm_unpackhi_epi64(t0, t2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out - 2 * out_stride), _mm_unpacklo_epi64(t1, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out - 3 * out_stride), _mm_unpackhi_epi64(t1, t3));
+}
+
+#endif
+
+/**
+ * Rotate a tile, in blocks of B x B pixels, with the edges that do not fill a block done by the scalar kernel.
+ * @tparam B Block size.
+ * @tparam KERNEL Block kernel.
+ */
+template <std::size_t B, void (*KERNEL)(const uint32_t *, std::size_t, uint32_t *, std::size_t)>
+__attribute__((always_inline)) static inline void
+rotate_tile(const uint32_t *in, std::size_t in_stride, std::size_t cols, std::size_t rows,
+            uint32_t *out, std::size_t out_stride)
+{
+    /* walk output rows, so each block of them is written in full before moving on */
+    std::size_t c = 0;
+    for (; c + B <= cols; c += B) {
+        std::size_t r = 0;
+        for (; r + B <= rows; r += B) {
+            KERNEL(in + r * in_stride + c, in_stride, out - c * out_stride + r, out_stride);
+        }
+        rotate_scalar(in + r * in_stride + c, in_stride, B, rows - r, out - c * out_stride + r, out_stride);
+    }
+    rotate_scalar(in + c, in_stride, cols - c, rows, out - c * out_stride, out_stride);
+}
+
+#ifdef SPECGRAM_X86_KERNELS
+
+static void
+rotate_tile_sse2(const uint32_t *in, std::size_t in_stride, std::size_t cols, std::size_t rows,
+                 uint32_t *out, std::size_t out_stride)
+{
+    rotate_tile<4, rotate4_sse2>(in, in_stride, cols, rows, out, out_stride);
+}
+
+#endif
+
+void
+RotatePixels(std::span<const uint32_t> input, std::size_t width, std::size_t height,
+             std::span<uint32_t> output, std::size_t output_stride, SimdLevel level)
+{
+    static const SimdLevel supported = GetSupportedSimdLevel();
+    if (input.size() != width * height) {
+        throw std::runtime_error("input size does not match image dimensions");
+    }
+    if (output_stride < height) {
+        throw std::runtime_error("output stride is smaller than rotated row");
+    }
+    if ((width == 0) || (height == 0)) {
+        return;
+    }
+    if (output.size() < (width - 1) * output_stride + height) {
+        throw std::runtime_error("output too small for rotated image");
+    }
+    level = std::min(level, supported);
+
+    for (std::size_t ty = 0; ty < height; ty += TILE_SIZE) {
+        std::size_t rows = std::min(TILE_SIZE, height - ty);
+        for (std::size_t tx = 0; tx < width; tx += TILE_SIZE) {
+            std::size_t cols = std::min(TILE_SIZE, width - tx);
+
+            /* input pixel (tx, ty) lands on row (width-1-tx), column ty */
+            auto in = input.data() + ty * width + tx;
+            auto out = output.data() + (width - 1 - tx) * output_stride + ty;
+
+#ifdef SPECGRAM_X86_KERNELS
+            if (level >= SimdLevel::kSSE2) {
+                rotate_tile_sse2(in, width, cols, rows, out, output_stride);
+                continue;
+            }
+#endif
+            rotate_scalar(in, width, cols, rows, out, output_stride);
+        }
+    }
+}
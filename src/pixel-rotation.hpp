@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _PIXEL_ROTATION_HPP_
+#define _PIXEL_ROTATION_HPP_
+
+#include "sample-conversion.hpp"
+
+#include <cstdint>
+#include <span>
+
+/**
+ * Rotates an image of RGBA pixels 90 degrees counter-clockwise, i.e.
+ * transposes it and reverses the order of the resulting rows. This is the
+ * rotation applied to horizontal output.
+ *
+ * The image is processed in cache-sized tiles, each transposed in blocks of
+ * 4x4 pixels (SSE2), so neither reads nor writes stride across the whole
+ * image one pixel at a time.
+ * @param input Pixels of input image, row by row.
+ * @param width Width of input image, in pixels.
+ * @param height Height of input image, in pixels.
+ * @param output Receives the rotated image, width rows of height pixels;
+ *               input pixel (x, y) lands on row (width-1-x), column y.
+ * @param output_stride Distance between the starts of output rows, in
+ *                      pixels; at least height. Allows rotating an image into
+ *                      part of a larger one.
+ * @param level Kernel to use; levels the CPU does not support fall back to the
+ *              best supported one.
+ */
+void RotatePixels(std::span<const uint32_t> input, std::size_t width, std::size_t height,
+                  std::span<uint32_t> output, std::size_t output_stride, SimdLevel level);
+
+/**
+ * Rotates an image of RGBA pixels 90 degrees counter-clockwise, using the best
+ * kernel supported by the running CPU.
+ */
+inline void RotatePixels(std::span<const uint32_t> input, std::size_t width, std::size_t height,
+                         std::span<uint32_t> output, std::size_t output_stride)
+{
+    static const SimdLevel level = GetSupportedSimdLevel();
+    RotatePixels(input, width, height, output, output_stride, level);
+}
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "png-writer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+/* size of the compressed data buffer, and thus the maximum size of an IDAT chunk */
+static constexpr std::size_t IDAT_CHUNK_SIZE = 64 * 1024;
+
+/* bytes per pixel (RGBA, 8 bits per channel) */
+static constexpr std::size_t PIXEL_SIZE = 4;
+
+/* largest image dimension allowed by the format */
+static constexpr std::size_t MAX_DIMENSION = 0x7fffffff;
+
+/* row filter types */
+static constexpr uint8_t FILTER_NONE = 0;
+static constexpr uint8_t FILTER_SUB = 1;
+static constexpr uint8_t FILTER_UP = 2;
+static constexpr uint8_t FILTER_AVERAGE = 3;
+static constexpr uint8_t FILTER_PAETH = 4;
+
+/* highest compression level that uses a single row filter */
+static constexpr int MAX_FAST_COMPRESSION_LEVEL = 3;
+
+static void
+put_uint32(uint8_t *out, uint32_t value)
+{
+    out[0] = (value >> 24) & 0xff;
+    out[1] = (value >> 16) & 0xff;
+    out[2] = (value >> 8) & 0xff;
+    out[3] = value & 0xff;
+}
+
+static uint8_t
+paeth_predictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if ((pa <= pb) && (pa <= pc)) {
+        return a;
+    } else if (pb <= pc) {
+        return b;
+    } else {
+        return c;
+    }
+}
+
+PngWriter::PngWriter(std::ostream& stream, std::size_t width, std::size_t height, int compression_level)
+    : stream_(stream), width_(width), height_(height), rows_written_(0), finished_(false)
+{
+    if (width == 0 || height == 0) {
+        throw std::runtime_error("PNG image dimensions must be positive");
+    }
+    if (width > MAX_DIMENSION || height > MAX_DIMENSION) {
+        throw std::runtime_error("PNG image dimensions are too large");
+    }
+    if (compression_level < 0 || compression_level > 9) {
+        throw std::runtime_error("PNG compression level must be between 0 and 9");
+    }
+
+    /* filtering does not pay off when not compressing; fast levels stick to the up filter, as spectrogram rows
+     * resemble their predecessors */
+    if (compression_level == 0) {
+        this->first_filter_ = this->last_filter_ = FILTER_NONE;
+    } else if (compression_level <= MAX_FAST_COMPRESSION_LEVEL) {
+        this->first_filter_ = this->last_filter_ = FILTER_UP;
+    } else {
+        this->first_filter_ = FILTER_NONE;
+        this->last_filter_ = FILTER_PAETH;
+    }
+
+    this->previous_row_.resize(width * PIXEL_SIZE, 0);
+    this->filtered_row_.resize(width * PIXEL_SIZE + 1);
+    this->candidate_row_.resize(width * PIXEL_SIZE + 1);
+    this->deflated_.resize(IDAT_CHUNK_SIZE);
+
+    /* signature */
+    static constexpr uint8_t SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    this->stream_.write(reinterpret_cast<const char *>(SIGNATURE), sizeof(SIGNATURE));
+
+    /* header: 8 bits per channel, RGBA, deflate, adaptive filtering, no interlacing */
+    uint8_t header[13] = { 0 };
+    put_uint32(header, width);
+    put_uint32(header + 4, height);
+    header[8] = 8;
+    header[9] = 6;
+    this->WriteChunk("IHDR", header);
+
+    /* compressor; initialized last, so nothing above leaks it by throwing */
+    std::memset(&this->zstream_, 0, sizeof(this->zstream_));
+    if (deflateInit(&this->zstream_, compression_level) != Z_OK) {
+        throw std::runtime_error("failed to initialize PNG compression");
+    }
+
+    this->zstream_.next_out = this->deflated_.data();
+    this->zstream_.avail_out = this->deflated_.size();
+}
+
+PngWriter::~PngWriter()
+{
+    deflateEnd(&this->zstream_);
+}
+
+void
+PngWriter::WriteChunk(const char *type, std::span<const uint8_t> data)
+{
+    uint8_t length[4], crc[4];
+    put_uint32(length, data.size());
+
+    uLong checksum = crc32(0L, Z_NULL, 0);
+    checksum = crc32(checksum, reinterpret_cast<const Bytef *>(type), 4);
+    if (!data.empty()) {
+        /* crc32() resets the checksum when given no buffer */
+        checksum = crc32(checksum, data.data(), data.size());
+    }
+    put_uint32(crc, checksum);
+
+    this->stream_.write(reinterpret_cast<const char *>(length), sizeof(length));
+    this->stream_.write(type, 4);
+    this->stream_.write(reinterpret_cast<const char *>(data.data()), data.size());
+    this->stream_.write(reinterpret_cast<const char *>(crc), sizeof(crc));
+    if (this->stream_.fail()) {
+        throw std::runtime_error("unable to write PNG image");
+    }
+}
+
+void
+PngWriter::FilterRow(std::span<const uint8_t> row)
+{
+    const auto& prev = this->previous_row_;
+    auto& best = this->filtered_row_;
+    auto& cand = this->candidate_row_;
+    uint64_t best_sum = UINT64_MAX;
+
+    for (uint8_t type = this->first_filter_; type <= this->last_filter_; type++) {
+        cand[0] = type;
+        uint64_t sum = 0;
+        for (std::size_t i = 0; i < row.size(); i++) {
+            int a = (i >= PIXEL_SIZE) ? row[i - PIXEL_SIZE] : 0;
+            int b = prev[i];
+            int c = (i >= PIXEL_SIZE) ? prev[i - PIXEL_SIZE] : 0;
+            uint8_t predicted = 0;
+            switch (type) {
+                case FILTER_SUB: predicted = a; break;
+                case FILTER_UP: predicted = b; break;
+                case FILTER_AVERAGE: predicted = (a + b) / 2; break;
+                case FILTER_PAETH: predicted = paeth_predictor(a, b, c); break;
+                default: break;
+            }
+            uint8_t value = row[i] - predicted;
+            cand[i + 1] = value;
+            sum += std::abs(static_cast<int8_t>(value));
+        }
+
+        if (sum < best_sum) {
+            best_sum = sum;
+            std::swap(best, cand);
+        }
+    }
+}
+
+void
+PngWriter::Deflate(std::span<const uint8_t> data, int flush)
+{
+    this->zstream_.next_in = const_cast<Bytef *>(data.data());
+    this->zstream_.avail_in = data.size();
+
+    for (;;) {
+        int ret = deflate(&this->zstream_, flush);
+        if (ret == Z_STREAM_ERROR) {
+            throw std::runtime_error("PNG compression failed");
+        }
+
+        bool done = (flush == Z_FINISH) ? (ret == Z_STREAM_END) : (this->zstream_.avail_in == 0);
+
+        /* flush full buffer */
+        if (this->zstream_.avail_out == 0) {
+            this->WriteChunk("IDAT", this->deflated_);
+            this->zstream_.next_out = this->deflated_.data();
+            this->zstream_.avail_out = this->deflated_.size();
+        }
+
+        if (done) {
+            break;
+        }
+    }
+}
+
+void
+PngWriter::WriteRows(std::span<const uint8_t> pixels)
+{
+    const std::size_t row_size = this->width_ * PIXEL_SIZE;
+    if (pixels.size() % row_size != 0) {
+        throw std::runtime_error("PNG pixel data must hold whole rows");
+    }
+    if (this->finished_ || (pixels.size() / row_size > this->height_ - this->rows_written_)) {
+        throw std::runtime_error("too many rows for PNG image");
+    }
+
+    for (std::size_t offset = 0; offset < pixels.size(); offset += row_size) {
+        auto row = pixels.subspan(offset, row_size);
+        this->FilterRow(row);
+        this->Deflate(this->filtered_row_, Z_NO_FLUSH);
+        std::copy(row.begin(), row.end(), this->previous_row_.begin());
+        this->rows_written_++;
+    }
+}
+
+void
+PngWriter::Finish()
+{
+    if (this->finished_) {
+        throw std::runtime_error("PNG image already finished");
+    }
+    if (this->rows_written_ != this->height_) {
+        throw std::runtime_error("PNG image is incomplete");
+    }
+
+    this->Deflate({}, Z_FINISH);
+    std::size_t pending = this->deflated_.size() - this->zstream_.avail_out;
+    if (pending > 0) {
+        this->WriteChunk("IDAT", std::span<const uint8_t>(this->deflated_).first(pending));
+    }
+    this->WriteChunk("IEND", {});
+
+    this->stream_.flush();
+    if (this->stream_.fail()) {
+        throw std::runtime_error("unable to write PNG image");
+    }
+    this->finished_ = true;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _PNG_WRITER_HPP_
+#define _PNG_WRITER_HPP_
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * Streaming PNG encoder for RGBA images.
+ *
+ * Rows are filtered and compressed as they are written, and compressed data
+ * is flushed to the stream in IDAT chunks, so memory use does not depend on
+ * the height of the image.
+ */
+class PngWriter {
+private:
+    std::ostream& stream_;      /* output stream */
+    std::size_t width_;         /* width of image, in pixels */
+    std::size_t height_;        /* height of image, in pixels */
+    std::size_t rows_written_;  /* number of rows written so far */
+    bool finished_;             /* true once the image end has been written */
+    uint8_t first_filter_;      /* range of row filter types tried for each row */
+    uint8_t last_filter_;
+
+    z_stream zstream_;          /* deflate state */
+
+    std::vector<uint8_t> previous_row_;    /* previous (unfiltered) row, zero before the first one */
+    std::vector<uint8_t> filtered_row_;    /* filter type byte followed by the filtered row */
+    std::vector<uint8_t> candidate_row_;   /* scratch space for trying out filters */
+    std::vector<uint8_t> deflated_;        /* compressed data, written out as an IDAT chunk when full */
+
+    /**
+     * Write a chunk to the stream.
+     * @param type Chunk type (four letters).
+     * @param data Chunk data.
+     */
+    void WriteChunk(const char *type, std::span<const uint8_t> data);
+
+    /**
+     * Filter a row into filtered_row_, picking the filter (out of the
+     * configured range) that yields the lowest sum of absolute differences.
+     * @param row Unfiltered row.
+     */
+    void FilterRow(std::span<const uint8_t> row);
+
+    /**
+     * Feed data to the compressor, writing IDAT chunks as needed.
+     * @param data Data to compress.
+     * @param flush Deflate flush mode.
+     */
+    void Deflate(std::span<const uint8_t> data, int flush);
+
+public:
+    /* default compression level; same as zlib's default */
+    static constexpr int DEFAULT_COMPRESSION_LEVEL = 6;
+
+    PngWriter() = delete;
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    /**
+     * Write the PNG header to a stream.
+     * @param stream Output stream, must outlive the writer.
+     * @param width Width of image, in pixels.
+     * @param height Height of image, in pixels.
+     * @param compression_level Compression level, from 0 (no compression,
+     *                          fastest) to 9 (smallest output, slowest).
+     *
+     * NOTE: Levels 0 to 3 apply a single, fixed filter to rows instead of
+     *       trying all five, trading some size for speed.
+     */
+    PngWriter(std::ostream& stream, std::size_t width, std::size_t height,
+              int compression_level = DEFAULT_COMPRESSION_LEVEL);
+    ~PngWriter();
+
+    /**
+     * Encode a number of rows.
+     * @param pixels RGBA values of one or more whole rows.
+     */
+    void WriteRows(std::span<const uint8_t> pixels);
+
+    /**
+     * Flush compressed data and write the end of the image. All rows must
+     * have been written.
+     */
+    void Finish();
+
+    auto GetWidth() const { return width_; }
+    auto GetHeight() const { return height_; }
+    auto GetRowsWritten() const { return rows_written_; }
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * Blend a color over a pixel, the way sf::BlendAlpha does.
+ * @param dst RGBA values of pixel.
+ * @param src Color to blend.
+ */
+static inline void
+blend(uint8_t *dst, const sf::Color& src)
+{
+    if (src.a == 255) {
+        dst[0] = src.r;
+        dst[1] = src.g;
+        dst[2] = src.b;
+        dst[3] = 255;
+        return;
+    }
+    if (src.a == 0) {
+        return;
+    }
+
+    unsigned int a = src.a;
+    unsigned int ia = 255 - a;
+    dst[0] = (src.r * a + dst[0] * ia + 127) / 255;
+    dst[1] = (src.g * a + dst[1] * ia + 127) / 255;
+    dst[2] = (src.b * a + dst[2] * ia + 127) / 255;
+    dst[3] = (a * 255 + dst[3] * ia + 127) / 255;
+}
+
+Raster::Raster(std::span<uint8_t> pixels, long left, long top, std::size_t width, std::size_t height)
+    : pixels_(pixels), left_(left), top_(top), width_(width), height_(height)
+{
+    if (pixels.size() != width * height * 4) {
+        throw std::runtime_error("raster buffer size does not match raster dimensions");
+    }
+}
+
+template <typename TEXEL>
+void
+Raster::Map(const sf::Transform& transform, std::size_t width, std::size_t height, TEXEL texel)
+{
+    if ((width == 0) || (height == 0)) {
+        return;
+    }
+
+    /* bounding box of area, clipped to window */
+    float min_x = std::numeric_limits<float>::max(), max_x = std::numeric_limits<float>::lowest();
+    float min_y = min_x, max_y = max_x;
+    for (auto corner : { sf::Vector2f(0.0f, 0.0f), sf::Vector2f(width, 0.0f),
+                         sf::Vector2f(0.0f, height), sf::Vector2f(width, height) }) {
+        auto p = transform.transformPoint(corner.x, corner.y);
+        min_x = std::min(min_x, p.x);
+        max_x = std::max(max_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_y = std::max(max_y, p.y);
+    }
+    long x0 = std::max<long>(this->left_, std::floor(min_x));
+    long x1 = std::min<long>(this->left_ + this->width_, std::ceil(max_x));
+    long y0 = std::max<long>(this->top_, std::floor(min_y));
+    long y1 = std::min<long>(this->top_ + this->height_, std::ceil(max_y));
+    if ((x0 >= x1) || (y0 >= y1)) {
+        return;
+    }
+
+    /* map pixel centers back onto the area; the mapping is affine, so step along rows and columns */
+    auto inverse = transform.getInverse();
+    auto origin = inverse.transformPoint(x0 + 0.5f, y0 + 0.5f);
+    auto along_x = inverse.transformPoint(x0 + 1.5f, y0 + 0.5f);
+    auto along_y = inverse.transformPoint(x0 + 0.5f, y0 + 1.5f);
+    double ux = along_x.x - origin.x, vx = along_x.y - origin.y;
+    double uy = along_y.x - origin.x, vy = along_y.y - origin.y;
+
+    for (long y = y0; y < y1; y++) {
+        uint8_t *row = this->pixels_.data() + ((y - this->top_) * this->width_ + (x0 - this->left_)) * 4;
+        double u = origin.x + (y - y0) * uy;
+        double v = origin.y + (y - y0) * vy;
+        for (long x = x0; x < x1; x++, row += 4, u += ux, v += vx) {
+            if ((u < 0.0) || (v < 0.0) || (u >= width) || (v >= height)) {
+                continue;
+            }
+            blend(row, texel(static_cast<std::size_t>(u), static_cast<std::size_t>(v)));
+        }
+    }
+}
+
+void
+Raster::Clear(const sf::Color& color)
+{
+    for (std::size_t i = 0; i < this->pixels_.size(); i += 4) {
+        this->pixels_[i + 0] = color.r;
+        this->pixels_[i + 1] = color.g;
+        this->pixels_[i + 2] = color.b;
+        this->pixels_[i + 3] = color.a;
+    }
+}
+
+void
+Raster::FillRect(const sf::Transform& transform, const sf::FloatRect& rect, const sf::Color& color)
+{
+    if ((rect.width == 0.0f) || (rect.height == 0.0f)) {
+        return;
+    }
+
+    /* a unit area, scaled over the rectangle */
+    sf::Transform area = transform;
+    area.translate(rect.left, rect.top).scale(rect.width, rect.height);
+    this->Map(area, 1, 1, [&color](std::size_t, std::size_t) { return color; });
+}
+
+void
+Raster::DrawImage(const sf::Transform& transform, std::size_t width, std::size_t height,
+                  std::span<const uint8_t> pixels)
+{
+    if (pixels.size() != width * height * 4) {
+        throw std::runtime_error("image size does not match image dimensions");
+    }
+    this->Map(transform, width, height, [&pixels, width](std::size_t x, std::size_t y) {
+        auto p = pixels.data() + (y * width + x) * 4;
+        return sf::Color(p[0], p[1], p[2], p[3]);
+    });
+}
+
+void
+Raster::DrawMask(const sf::Transform& transform, std::size_t width, std::size_t height,
+                 std::span<const uint8_t> coverage, const sf::Color& color)
+{
+    if (coverage.size() != width * height) {
+        throw std::runtime_error("mask size does not match mask dimensions");
+    }
+    this->Map(transform, width, height, [&coverage, &color, width](std::size_t x, std::size_t y) {
+        sf::Color c = color;
+        c.a = (color.a * coverage[y * width + x] + 127) / 255;
+        return c;
+    });
+}
+
+sf::FloatRect
+Raster::GetBounds() const
+{
+    return sf::FloatRect(this->left_, this->top_, this->width_, this->height_);
+}
+
+RasterFont::RasterFont(std::span<const uint8_t> data, unsigned int size)
+    : size_(size)
+{
+    if (size == 0) {
+        throw std::runtime_error("positive font size required");
+    }
+    if (FT_Init_FreeType(&this->library_) != 0) {
+        throw std::runtime_error("unable to initialize font rasterizer");
+    }
+    if ((FT_New_Memory_Face(this->library_, data.data(), data.size(), 0, &this->face_) != 0)
+        || (FT_Set_Pixel_Sizes(this->face_, 0, size) != 0)) {
+        FT_Done_FreeType(this->library_);
+        throw std::runtime_error("unable to load font");
+    }
+}
+
+RasterFont::~RasterFont()
+{
+    FT_Done_Face(this->face_);
+    FT_Done_FreeType(this->library_);
+}
+
+const RasterFont::Glyph&
+RasterFont::GetGlyph(uint32_t code)
+{
+    auto it = this->glyphs_.find(code);
+    if (it != this->glyphs_.end()) {
+        return it->second;
+    }
+
+    /* same hinting and rendering as SFML; characters missing from the font are left blank */
+    Glyph glyph { 0, 0, 0, 0, 0.0f, {} };
+    if (FT_Load_Char(this->face_, code, FT_LOAD_TARGET_NORMAL | FT_LOAD_FORCE_AUTOHINT | FT_LOAD_RENDER) == 0) {
+        const auto slot = this->face_->glyph;
+        const auto& bitmap = slot->bitmap;
+        if ((bitmap.width > 0) && (bitmap.rows > 0) && (bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)) {
+            throw std::runtime_error("unsupported glyph bitmap format");
+        }
+
+        glyph.left = slot->bitmap_left;
+        glyph.top = slot->bitmap_top;
+        glyph.width = bitmap.width;
+        glyph.height = bitmap.rows;
+        glyph.advance = static_cast<float>(slot->metrics.horiAdvance) / 64.0f;
+        glyph.coverage.resize(glyph.width * glyph.height);
+        for (std::size_t y = 0; y < glyph.height; y++) {
+            std::copy_n(bitmap.buffer + y * bitmap.pitch, glyph.width, glyph.coverage.begin() + y * glyph.width);
+        }
+    }
+
+    return this->glyphs_.emplace(code, std::move(glyph)).first->second;
+}
+
+sf::FloatRect
+RasterFont::GetTextBounds(const std::string& text)
+{
+    float min_x = std::numeric_limits<float>::max(), max_x = std::numeric_limits<float>::lowest();
+    float min_y = min_x, max_y = max_x;
+    const float baseline = this->size_;
+
+    float x = 0.0f;
+    for (unsigned char c : text) {
+        const auto& glyph = this->GetGlyph(c);
+        if ((glyph.width > 0) && (glyph.height > 0)) {
+            min_x = std::min(min_x, x + glyph.left);
+            max_x = std::max(max_x, x + glyph.left + glyph.width);
+            min_y = std::min(min_y, baseline - glyph.top);
+            max_y = std::max(max_y, baseline - glyph.top + glyph.height);
+        } else {
+            /* blank characters (e.g. spaces) take up their advance, on the baseline */
+            min_x = std::min(min_x, x);
+            max_x = std::max(max_x, x + glyph.advance);
+            min_y = std::min(min_y, baseline);
+            max_y = std::max(max_y, baseline);
+        }
+        x += glyph.advance;
+    }
+
+    if (min_x > max_x) {
+        return sf::FloatRect(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    return sf::FloatRect(min_x, min_y, max_x - min_x, max_y - min_y);
+}
+
+void
+RasterFont::DrawText(Raster& raster, const std::string& text, const sf::Transform& transform,
+                     const sf::Color& color)
+{
+    const float baseline = this->size_;
+
+    float x = 0.0f;
+    for (unsigned char c : text) {
+        const auto& glyph = this->GetGlyph(c);
+        sf::Transform glyph_transform = transform;
+        glyph_transform.translate(x + glyph.left, baseline - glyph.top);
+        raster.DrawMask(glyph_transform, glyph.width, glyph.height, glyph.coverage, color);
+        x += glyph.advance;
+    }
+}
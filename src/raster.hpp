@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _RASTER_HPP_
+#define _RASTER_HPP_
+
+#include <SFML/Graphics.hpp>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * Software rasterizer, drawing into a buffer of RGBA pixels. Needs no
+ * graphics context, so output can be rendered on headless machines.
+ *
+ * The buffer holds a window of a larger canvas; all drawing is done in canvas
+ * coordinates and clipped to the window. Shapes are drawn through transforms
+ * (which must keep them axis-aligned, i.e. rotate by multiples of 90 degrees)
+ * and follow the rules of SFML: a pixel is covered if its center is, and the
+ * texel it shows is the one under its center; colors are alpha blended.
+ */
+class Raster {
+private:
+    std::span<uint8_t> pixels_; /* RGBA values of window, row by row */
+    long left_;                 /* window position on canvas */
+    long top_;
+    std::size_t width_;         /* window size */
+    std::size_t height_;
+
+    /**
+     * Draw an area of texels through a transform.
+     * @param transform Transform from area to canvas coordinates.
+     * @param width Width of area, in texels.
+     * @param height Height of area, in texels.
+     * @param texel Called with the column and row of a texel, returns its color.
+     */
+    template <typename TEXEL>
+    void Map(const sf::Transform& transform, std::size_t width, std::size_t height, TEXEL texel);
+
+public:
+    Raster() = delete;
+    Raster(const Raster&) = delete;
+    Raster& operator=(const Raster&) = delete;
+
+    /**
+     * @param pixels RGBA values of window, row by row; must outlive the raster.
+     * @param left Left edge of window, in canvas coordinates.
+     * @param top Top edge of window, in canvas coordinates.
+     * @param width Width of window.
+     * @param height Height of window.
+     */
+    Raster(std::span<uint8_t> pixels, long left, long top, std::size_t width, std::size_t height);
+
+    /**
+     * Fill the whole window with a color, without blending.
+     * @param color Color to fill with.
+     */
+    void Clear(const sf::Color& color);
+
+    /**
+     * Fill a rectangle.
+     * @param transform Transform from rectangle to canvas coordinates.
+     * @param rect Rectangle; width and height may be negative.
+     * @param color Fill color.
+     */
+    void FillRect(const sf::Transform& transform, const sf::FloatRect& rect, const sf::Color& color);
+
+    /**
+     * Draw an image.
+     * @param transform Transform from image to canvas coordinates; may scale.
+     * @param width Width of image.
+     * @param height Height of image.
+     * @param pixels RGBA values of image, row by row.
+     */
+    void DrawImage(const sf::Transform& transform, std::size_t width, std::size_t height,
+                   std::span<const uint8_t> pixels);
+
+    /**
+     * Draw a single color through a coverage mask (e.g. a glyph).
+     * @param transform Transform from mask to canvas coordinates.
+     * @param width Width of mask.
+     * @param height Height of mask.
+     * @param coverage Coverage values of mask, row by row; 255 is opaque.
+     * @param color Color to draw.
+     */
+    void DrawMask(const sf::Transform& transform, std::size_t width, std::size_t height,
+                  std::span<const uint8_t> coverage, const sf::Color& color);
+
+    /**
+     * @return Window, in canvas coordinates.
+     */
+    sf::FloatRect GetBounds() const;
+
+    auto GetWidth() const { return width_; }
+    auto GetHeight() const { return height_; }
+};
+
+/**
+ * Font rasterized with FreeType, with glyphs cached as coverage masks. Text is
+ * laid out the way sf::Text does it, so measurements and drawings match those
+ * of SFML for the same font and character size.
+ */
+class RasterFont {
+private:
+    struct Glyph {
+        long left;                      /* bitmap offset from pen position; top is above the baseline */
+        long top;
+        std::size_t width;              /* bitmap size */
+        std::size_t height;
+        float advance;                  /* pen advance */
+        std::vector<uint8_t> coverage;  /* bitmap, row by row */
+    };
+
+    FT_Library library_;
+    FT_Face face_;
+    unsigned int size_;                 /* character size, in pixels */
+    std::map<uint32_t, Glyph> glyphs_;  /* rasterized glyphs, by code point */
+
+    /**
+     * @param code Code point of character.
+     * @return Glyph of character, rasterized on first use.
+     */
+    const Glyph& GetGlyph(uint32_t code);
+
+public:
+    RasterFont() = delete;
+    RasterFont(const RasterFont&) = delete;
+    RasterFont& operator=(const RasterFont&) = delete;
+
+    /**
+     * @param data Font file contents; must outlive the font.
+     * @param size Character size, in pixels.
+     */
+    RasterFont(std::span<const uint8_t> data, unsigned int size);
+    ~RasterFont();
+
+    /**
+     * @param text Text to measure; bytes are taken as Latin-1 characters.
+     * @return Bounds of the drawn text, relative to its origin (the top of a
+     *         line, with the baseline one character size below), as
+     *         sf::Text::getLocalBounds() would report them.
+     */
+    sf::FloatRect GetTextBounds(const std::string& text);
+
+    /**
+     * Draw text onto a raster.
+     * @param raster Raster to draw on.
+     * @param text Text to draw; bytes are taken as Latin-1 characters.
+     * @param transform Transform from text to canvas coordinates.
+     * @param color Text color.
+     */
+    void DrawText(Raster& raster, const std::string& text, const sf::Transform& transform, const sf::Color& color);
+
+    auto GetSize() const { return size_; }
+};
+
+#endif
@@ -7,11 +7,14 @@
 #include "renderer.hpp"
 #include "share-tech-mono.hpp"
 #include "fft.hpp"
+#include "pixel-rotation.hpp"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <cassert>
 #include <cstring>
+#include <limits>
 
 static double compute_error_for_scale(double v, int scale, double v_min, double v_max)
 {
@@ -20,6 +23,32 @@ static double compute_error_for_scale(double v, int scale, double v_min, double
     return std::abs(rsv - sv) / std::pow(10, scale) / (v_max - v_min);
 }
 
+/**
+ * Draw a box with a one pixel outline around it, like a sf::RectangleShape with an outline thickness of 1.
+ */
+static void
+draw_box(Raster& target, const sf::Transform& t, float width, float height,
+         const sf::Color& fill_color, const sf::Color& outline_color)
+{
+    target.FillRect(t, sf::FloatRect(0.0f, 0.0f, width, height), fill_color);
+    target.FillRect(t, sf::FloatRect(-1.0f, -1.0f, width + 2.0f, 1.0f), outline_color);
+    target.FillRect(t, sf::FloatRect(-1.0f, height, width + 2.0f, 1.0f), outline_color);
+    target.FillRect(t, sf::FloatRect(-1.0f, 0.0f, 1.0f, height), outline_color);
+    target.FillRect(t, sf::FloatRect(width, 0.0f, 1.0f, height), outline_color);
+}
+
+/**
+ * Range of values of the FFT area (windows or columns) visible in a span of canvas coordinates, with one extra value
+ * on each side in case the area is not pixel aligned.
+ */
+static std::pair<std::size_t, std::size_t>
+visible_range(double start, double end, double origin, std::size_t count)
+{
+    auto first = std::max(0.0, std::floor(start - origin) - 1.0);
+    auto last = std::clamp(std::ceil(end - origin) + 1.0, 0.0, (double) count);
+    return { static_cast<std::size_t>(std::min(first, last)), static_cast<std::size_t>(last) };
+}
+
 std::string
 Renderer::ValueToShortString(double value, int scale, const std::string& unit)
 {
@@ -53,6 +82,8 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
     , fft_count_(fft_count)
     , color_map_(ColorMap::Build(conf.GetColorMap(), conf.GetBackgroundColor(),
                                  conf.GetColorMapCustomColor()))
+    , font_(std::span<const uint8_t>(ShareTechMono_Regular_ttf, ShareTechMono_Regular_ttf_len),
+            conf.GetAxisFontSize())
 {
     if (color_map_ == nullptr) {
         throw std::runtime_error("failed to build colormap");
@@ -61,36 +92,44 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
         throw std::runtime_error("positive number of FFT windows required by renderer");
     }
 
-    /* load font */
-    if (!this->font_.loadFromMemory(ShareTechMono_Regular_ttf, ShareTechMono_Regular_ttf_len)) {
-        throw std::runtime_error("unable to load font");
-    }
-
     /* compute tickmarks */
-    this->frequency_ticks_ =
+    auto assign_ticks = [](std::vector<AxisTick>& ticks, const std::list<AxisTick>& list) {
+        ticks.assign(list.begin(), list.end());
+    };
+    assign_ticks(this->frequency_ticks_,
         Renderer::GetNiceTicks(this->configuration_.GetMinFreq(), this->configuration_.GetMaxFreq(),
-                               "Hz", this->configuration_.GetWidth(), 50, this->configuration_.IsHorizontal());
-    auto time_ticks =
+                               "Hz", this->configuration_.GetWidth(), 50, this->configuration_.IsHorizontal()));
+    assign_ticks(this->time_ticks_,
         Renderer::GetNiceTicks(0.0f, (double)fft_count * this->configuration_.GetAverageCount() * this->configuration_.GetFFTStride() / this->configuration_.GetRate(),
-                               "s", fft_count, 30, !this->configuration_.IsHorizontal());
+                               "s", fft_count, 30, !this->configuration_.IsHorizontal()));
 
     auto vmap = ValueMap::Build(conf.GetScaleType(),
                                 conf.GetScaleLowerBound(),
                                 conf.GetScaleUpperBound(),
                                 conf.GetScaleUnit());
-    auto legend_ticks = Renderer::GetNiceTicks(vmap->GetLowerBound(), vmap->GetUpperBound(),
-                                               vmap->GetUnit(), this->configuration_.GetWidth(), 50,
-                                               this->configuration_.IsHorizontal());
-    this->live_ticks_ = Renderer::GetNiceTicks(vmap->GetLowerBound(), vmap->GetUpperBound(),
-                                               "", this->configuration_.GetLiveFFTHeight(), 20,
-                                               !this->configuration_.IsHorizontal()); /* no unit, keep it short */
-
-    std::list<AxisTick> freq_no_text_ticks;
-    for (auto& t : this->frequency_ticks_) {
-        freq_no_text_ticks.emplace_back(std::make_tuple(std::get<0>(t), ""));
+    assign_ticks(this->legend_ticks_, Renderer::GetNiceTicks(vmap->GetLowerBound(), vmap->GetUpperBound(),
+                                                             vmap->GetUnit(), this->configuration_.GetWidth(), 50,
+                                                             this->configuration_.IsHorizontal()));
+    assign_ticks(this->live_ticks_, Renderer::GetNiceTicks(vmap->GetLowerBound(), vmap->GetUpperBound(),
+                                                           "", this->configuration_.GetLiveFFTHeight(), 20,
+                                                           !this->configuration_.IsHorizontal())); /* no unit, keep it short */
+
+    this->max_tick_text_length_ = 0;
+    for (const auto *ticks : { &this->frequency_ticks_, &this->time_ticks_, &this->legend_ticks_, &this->live_ticks_ }) {
+        for (const auto& t : *ticks) {
+            this->max_tick_text_length_ = std::max(this->max_tick_text_length_, std::get<1>(t).size());
+        }
     }
 
     /* get maximum text widths */
+    auto measure_ticks = [this](const std::vector<AxisTick>& ticks, double& max_width, double& max_height) {
+        for (auto &t : ticks) {
+            auto bounds = this->font_.GetTextBounds(std::get<1>(t));
+            max_width = std::max<double>(max_width, bounds.width);
+            max_height = std::max<double>(max_height, bounds.height);
+        }
+    };
+
     double max_freq_ticks_width = 0.0f;
     double max_freq_ticks_height = 0.0f;
 
@@ -104,57 +143,10 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
     double max_live_ticks_height = 0.0f;
 
     if (this->configuration_.HasAxes()) {
-        for (auto &t : this->frequency_ticks_) {
-            sf::Text text;
-            text.setCharacterSize(this->configuration_.GetAxisFontSize());
-            text.setFont(this->font_);
-            text.setString(std::get<1>(t));
-            if (text.getLocalBounds().width > max_freq_ticks_width) {
-                max_freq_ticks_width = text.getLocalBounds().width;
-            }
-            if (text.getLocalBounds().height > max_freq_ticks_height) {
-                max_freq_ticks_height = text.getLocalBounds().height;
-            }
-        }
-
-        for (auto &t : time_ticks) {
-            sf::Text text;
-            text.setCharacterSize(this->configuration_.GetAxisFontSize());
-            text.setFont(this->font_);
-            text.setString(std::get<1>(t));
-            if (text.getLocalBounds().width > max_time_ticks_width) {
-                max_time_ticks_width = text.getLocalBounds().width;
-            }
-            if (text.getLocalBounds().height > max_time_ticks_height) {
-                max_time_ticks_height = text.getLocalBounds().height;
-            }
-        }
-
-        for (auto &t : legend_ticks) {
-            sf::Text text;
-            text.setCharacterSize(this->configuration_.GetAxisFontSize());
-            text.setFont(this->font_);
-            text.setString(std::get<1>(t));
-            if (text.getLocalBounds().width > max_legend_ticks_width) {
-                max_legend_ticks_width = text.getLocalBounds().width;
-            }
-            if (text.getLocalBounds().height > max_legend_ticks_height) {
-                max_legend_ticks_height = text.getLocalBounds().height;
-            }
-        }
-
-        for (auto &t : this->live_ticks_) {
-            sf::Text text;
-            text.setCharacterSize(this->configuration_.GetAxisFontSize());
-            text.setFont(this->font_);
-            text.setString(std::get<1>(t));
-            if (text.getLocalBounds().width > max_live_ticks_width) {
-                max_live_ticks_width = text.getLocalBounds().width;
-            }
-            if (text.getLocalBounds().height > max_live_ticks_height) {
-                max_live_ticks_height = text.getLocalBounds().height;
-            }
-        }
+        measure_ticks(this->frequency_ticks_, max_freq_ticks_width, max_freq_ticks_height);
+        measure_ticks(this->time_ticks_, max_time_ticks_width, max_time_ticks_height);
+        measure_ticks(this->legend_ticks_, max_legend_ticks_width, max_legend_ticks_height);
+        measure_ticks(this->live_ticks_, max_live_ticks_width, max_live_ticks_height);
     }
 
     double freq_axis_spacing = (this->configuration_.IsHorizontal() ? max_freq_ticks_width : max_freq_ticks_height);
@@ -181,6 +173,7 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
         this->height_ += conf.GetLegendHeight();
     }
 
+    double live_top = this->height_;
     this->live_transform_.translate(0.0f, this->height_);
     if (conf.HasLiveWindow()) {
         if (this->configuration_.HasAxes()) {
@@ -191,6 +184,7 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
         this->height_ += conf.GetLiveFFTHeight();
     }
 
+    double spectrogram_top = this->height_;
     this->spectrogram_transform_.translate(0.0f, this->height_);
     if (conf.HasAxes()) {
         this->spectrogram_transform_.translate(conf.GetMarginSize() + horizontal_extra_spacing,
@@ -199,69 +193,79 @@ Renderer::Renderer(const Configuration& conf, std::size_t fft_count)
     }
     this->height_ += this->fft_count_;
 
-    /* allocate canvas render texture */
-    this->canvas_.create(this->width_, this->height_);
-    this->canvas_.clear(this->configuration_.GetBackgroundColor());
+    /* elements are stacked top to bottom; tick texts may stick out by up to a character into neighbouring areas */
+    const double overhang = conf.GetAxisFontSize();
+    double spectrogram_origin = this->spectrogram_transform_.transformPoint(0.0f, 0.0f).y;
+    this->legend_area_ = sf::FloatRect(0.0f, -overhang, this->width_, live_top + 2.0f * overhang);
+    this->live_area_ = sf::FloatRect(0.0f, live_top - overhang, this->width_, spectrogram_top - live_top + 2.0f * overhang);
+    this->frequency_axis_area_ = sf::FloatRect(0.0f, spectrogram_top - overhang, this->width_,
+                                               spectrogram_origin - spectrogram_top + 2.0f * overhang);
 
-    /* allocate FFT area texture */
-    this->spectrogram_texture_.create(conf.GetWidth(), fft_count);
+    /* legend colors are the same for every tile */
+    if (conf.HasLegend()) {
+        this->legend_gradient_ = this->color_map_->Gradient(conf.GetWidth());
+    }
+
+    /* canvas and FFT area texture are allocated on first use; file output is rendered in tiles instead */
+    this->spectrogram_head_ = 0;
+    this->canvas_dirty_ = false;
+}
 
-    /*
-     * render UI
-     */
+void
+Renderer::RenderUserInterface(Raster& target)
+{
+    const auto visible = target.GetBounds();
 
     /* render FFT area axes */
     if (this->configuration_.HasAxes()) {
         /* FFT area box */
-        sf::RectangleShape fft_area_box(sf::Vector2f(this->configuration_.GetWidth(), this->fft_count_));
-        fft_area_box.setFillColor(this->configuration_.GetBackgroundColor());
-        fft_area_box.setOutlineColor(this->configuration_.GetForegroundColor());
-        fft_area_box.setOutlineThickness(1);
-        this->canvas_.draw(fft_area_box, this->spectrogram_transform_);
+        draw_box(target, this->spectrogram_transform_, this->configuration_.GetWidth(), this->fft_count_,
+                 this->configuration_.GetBackgroundColor(), this->configuration_.GetForegroundColor());
 
         /* frequency axis */
-        this->RenderAxis(this->canvas_, this->spectrogram_transform_,
-                         true, this->configuration_.IsHorizontal() ? Orientation::k90CW : Orientation::kNormal,
-                         this->configuration_.GetWidth(), this->frequency_ticks_);
+        if (visible.intersects(this->frequency_axis_area_)) {
+            this->RenderAxis(target, this->spectrogram_transform_,
+                             true, this->configuration_.IsHorizontal() ? Orientation::k90CW : Orientation::kNormal,
+                             this->configuration_.GetWidth(), this->frequency_ticks_);
+        }
 
         /* time axis */
-        this->RenderAxis(this->canvas_, this->spectrogram_transform_ * sf::Transform().rotate(90.0f),
+        this->RenderAxis(target, this->spectrogram_transform_ * sf::Transform().rotate(90.0f),
                          false, this->configuration_.IsHorizontal() ? Orientation::kNormal : Orientation::k90CCW,
-                         fft_count, time_ticks);
+                         this->fft_count_, this->time_ticks_);
     }
 
-    if (this->configuration_.HasLegend()) {
+    if (this->configuration_.HasLegend() && visible.intersects(this->legend_area_)) {
         /* legend box */
-        sf::RectangleShape legend_box(sf::Vector2f(this->configuration_.GetWidth(),
-                                                   this->configuration_.GetLegendHeight()));
-        legend_box.setFillColor(this->configuration_.GetBackgroundColor());
-        legend_box.setOutlineColor(this->configuration_.GetForegroundColor());
-        legend_box.setOutlineThickness(1);
-        this->canvas_.draw(legend_box, this->legend_transform_);
+        draw_box(target, this->legend_transform_, this->configuration_.GetWidth(),
+                 this->configuration_.GetLegendHeight(),
+                 this->configuration_.GetBackgroundColor(), this->configuration_.GetForegroundColor());
 
         /* legend gradient */
-        auto memory = color_map_->Gradient(this->configuration_.GetWidth());
-        sf::Texture tex;
-        tex.create(this->configuration_.GetWidth(), 1);
-        tex.update(reinterpret_cast<const uint8_t *>(memory.data()));
-        this->canvas_.draw(sf::Sprite(tex), this->legend_transform_ * sf::Transform().scale(1.0f, this->configuration_.GetLegendHeight()));
+        target.DrawImage(this->legend_transform_ * sf::Transform().scale(1.0f, this->configuration_.GetLegendHeight()),
+                         this->configuration_.GetWidth(), 1, this->legend_gradient_);
 
         if (this->configuration_.HasAxes()) {
-            this->RenderAxis(this->canvas_, this->legend_transform_,
+            this->RenderAxis(target, this->legend_transform_,
                              true, this->configuration_.IsHorizontal() ? Orientation::k90CW : Orientation::kNormal,
-                             this->configuration_.GetWidth(), legend_ticks);
+                             this->configuration_.GetWidth(), this->legend_ticks_);
         }
     }
 
-    if (this->configuration_.HasLiveWindow() && this->configuration_.HasAxes()) {
+    if (this->configuration_.HasLiveWindow() && this->configuration_.HasAxes() && visible.intersects(this->live_area_)) {
+        std::vector<AxisTick> freq_no_text_ticks;
+        for (auto& t : this->frequency_ticks_) {
+            freq_no_text_ticks.emplace_back(std::make_tuple(std::get<0>(t), ""));
+        }
+
         /* value axis */
-        this->RenderAxis(this->canvas_,
+        this->RenderAxis(target,
                          this->live_transform_ * sf::Transform().translate(0.0f, this->configuration_.GetLiveFFTHeight()).rotate(-90.0f),
                          true, this->configuration_.IsHorizontal() ? Orientation::k180 : Orientation::k90CW,
                          this->configuration_.GetLiveFFTHeight(), this->live_ticks_);
 
         /* frequency axis */
-        this->RenderAxis(this->canvas_, this->live_transform_ * sf::Transform().translate(0.0f, this->configuration_.GetLiveFFTHeight()),
+        this->RenderAxis(target, this->live_transform_ * sf::Transform().translate(0.0f, this->configuration_.GetLiveFFTHeight()),
                          false, this->configuration_.IsHorizontal() ? Orientation::k90CW : Orientation::kNormal,
                          this->configuration_.GetWidth(), freq_no_text_ticks);
     }
@@ -373,11 +377,8 @@ Renderer::GetNiceTicks(double v_min, double v_max, const std::string& v_unit, un
     /* computes text width */
     auto compute_text_size = [this, rotated](const std::string& str) -> double
     {
-        sf::Text text;
-        text.setCharacterSize(this->configuration_.GetAxisFontSize());
-        text.setFont(this->font_);
-        text.setString(str);
-        return (rotated ? text.getLocalBounds().height : text.getLocalBounds().width);
+        auto bounds = this->font_.GetTextBounds(str);
+        return (rotated ? bounds.height : bounds.width);
     };
 
     /* find the first nice value */
@@ -451,60 +452,171 @@ Renderer::GetNiceTicks(double v_min, double v_max, const std::string& v_unit, un
 }
 
 void
-Renderer::RenderAxis(sf::RenderTexture& texture,
+Renderer::RenderAxis(Raster& target,
                      const sf::Transform& t, bool lhs, Orientation orientation, double length,
-                     const std::list<AxisTick>& ticks)
+                     std::span<const AxisTick> ticks)
 {
     if (length <= 0.0f) {
         throw std::runtime_error("positive axis length required for rendering");
     }
 
-    for (auto& tick : ticks) {
-        /* draw tick line */
+    /* visible area of target; when rendering a tile, most ticks of a long axis fall outside of it */
+    const auto visible = target.GetBounds();
+
+    /* ticks are sorted along the axis, so those that can reach the visible area (with their text, no glyph of which
+     * is wider or taller than the font size) form a range; bisect for it in axis coordinates */
+    const double reach = (this->max_tick_text_length_ + 1) * this->configuration_.GetAxisFontSize() + 10.0f;
+    const auto inverse = t.getInverse();
+    double axis_min = std::numeric_limits<double>::max(), axis_max = std::numeric_limits<double>::lowest();
+    for (auto corner : { sf::Vector2f(visible.left - reach, visible.top - reach),
+                         sf::Vector2f(visible.left + visible.width + reach, visible.top - reach),
+                         sf::Vector2f(visible.left - reach, visible.top + visible.height + reach),
+                         sf::Vector2f(visible.left + visible.width + reach, visible.top + visible.height + reach) }) {
+        double x = inverse.transformPoint(corner.x, corner.y).x;
+        axis_min = std::min(axis_min, x);
+        axis_max = std::max(axis_max, x);
+    }
+    auto first = std::lower_bound(ticks.begin(), ticks.end(), axis_min, [length](const AxisTick& tick, double x) {
+        return (length - 1) * std::get<0>(tick) < x;
+    });
+    auto last = std::upper_bound(first, ticks.end(), axis_max, [length](double x, const AxisTick& tick) {
+        return x < (length - 1) * std::get<0>(tick);
+    });
+
+    for (const auto& tick : std::span<const AxisTick>(first, last)) {
         double x = (length - 1) * std::get<0>(tick);
-        sf::RectangleShape tick_shape(sf::Vector2f(1.0, (lhs ? -5.0f : 5.0f)));
-        tick_shape.setFillColor(this->configuration_.GetForegroundColor());
-        texture.draw(tick_shape, t * sf::Transform().translate(x, 0.0f));
+
+        /* skip ticks that cannot reach the visible area; no glyph is wider or taller than the font size */
+        double extent = (std::get<1>(tick).size() + 1) * this->configuration_.GetAxisFontSize() + 10.0f;
+        auto anchor = t.transformPoint(x, 0.0f);
+        if ((anchor.x + extent < visible.left) || (anchor.x - extent > visible.left + visible.width)
+            || (anchor.y + extent < visible.top) || (anchor.y - extent > visible.top + visible.height)) {
+            continue;
+        }
+
+        /* draw tick line */
+        target.FillRect(t * sf::Transform().translate(x, 0.0f), sf::FloatRect(0.0f, 0.0f, 1.0f, (lhs ? -5.0f : 5.0f)),
+                        this->configuration_.GetForegroundColor());
 
         /* draw text */
-        sf::Text text;
-        text.setFillColor(this->configuration_.GetForegroundColor());
-        text.setCharacterSize(this->configuration_.GetAxisFontSize());
-        text.setFont(this->font_);
-        text.setString(std::get<1>(tick));
+        const auto& text = std::get<1>(tick);
+        auto bounds = this->font_.GetTextBounds(text);
 
         sf::Vector2f pos;
+        float rotation = 0.0f;
         switch (orientation) {
             case Orientation::k90CCW:
-                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) - text.getLocalBounds().height,
-                                                (lhs ? -10.0f : text.getLocalBounds().width + 10.0f)));
-                text.setRotation(-90.0f);
+                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) - bounds.height,
+                                                (lhs ? -10.0f : bounds.width + 10.0f)));
+                rotation = -90.0f;
                 break;
 
             case Orientation::k90CW:
-                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) + text.getLocalBounds().height,
-                                                (lhs ? -text.getLocalBounds().width - 10.0f : 10.0f)));
-                text.setRotation(90.0f);
+                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) + bounds.height,
+                                                (lhs ? -bounds.width - 10.0f : 10.0f)));
+                rotation = 90.0f;
                 break;
 
             case Orientation::kNormal:
-                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) - text.getLocalBounds().width / 2,
-                                                (lhs ? -2.0f * text.getLocalBounds().height - 3.0f : 3.0f)));
+                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) - bounds.width / 2,
+                                                (lhs ? -2.0f * bounds.height - 3.0f : 3.0f)));
                 break;
 
             case Orientation::k180:
-                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) + text.getLocalBounds().width / 2,
-                                                (lhs ? -3.0f : 2.0f * text.getLocalBounds().height + 3.0f)));
-                text.setRotation(180.0f);
+                pos = sf::Vector2f(sf::Vector2f(length * std::get<0>(tick) + bounds.width / 2,
+                                                (lhs ? -3.0f : 2.0f * bounds.height + 3.0f)));
+                rotation = 180.0f;
                 break;
 
             default:
                 throw std::runtime_error("unknown orientation");
         }
 
-        text.setPosition(std::round(pos.x), std::round(pos.y)); /* avoid interpolation on text, looks yuck */
-        texture.draw(text, t);
+        /* avoid interpolation on text, looks yuck */
+        sf::Transform text_transform = t;
+        text_transform.translate(std::round(pos.x), std::round(pos.y)).rotate(rotation);
+        this->font_.DrawText(target, text, text_transform, this->configuration_.GetForegroundColor());
+    }
+}
+
+void
+Renderer::PrepareCanvas()
+{
+    if (this->live_canvas_ != nullptr) {
+        return;
+    }
+    this->live_canvas_ = std::make_unique<LiveCanvas>();
+
+    /* allocate canvas render texture */
+    this->live_canvas_->canvas.create(this->width_, this->height_);
+    this->live_canvas_->canvas.clear(this->configuration_.GetBackgroundColor());
+
+    /* allocate FFT area texture */
+    this->live_canvas_->spectrogram_texture.create(this->configuration_.GetWidth(), this->fft_count_);
+    this->spectrogram_head_ = 0;
+
+    /* pre-render the static part of the live plot, and allocate the plot itself */
+    if (this->configuration_.HasLiveWindow()) {
+        this->RenderLiveBackground();
+        this->live_canvas_->plot.setPrimitiveType(sf::LineStrip);
+        this->live_canvas_->plot.setUsage(sf::VertexBuffer::Stream);
+        this->live_canvas_->plot.create(this->configuration_.GetWidth());
+    }
+
+    /* render UI on the CPU, as for file output, then copy it onto the canvas */
+    std::vector<uint8_t> ui_pixels(this->width_ * this->height_ * 4);
+    Raster ui(ui_pixels, 0, 0, this->width_, this->height_);
+    ui.Clear(this->configuration_.GetBackgroundColor());
+    this->RenderUserInterface(ui);
+
+    sf::Texture ui_texture;
+    if (!ui_texture.create(this->width_, this->height_)) {
+        throw std::runtime_error("unable to create canvas texture");
+    }
+    ui_texture.update(ui_pixels.data());
+    this->live_canvas_->canvas.draw(sf::Sprite(ui_texture), sf::RenderStates(sf::BlendNone));
+    this->canvas_dirty_ = true;
+}
+
+void
+Renderer::RenderLiveBackground()
+{
+    const std::size_t width = this->configuration_.GetWidth();
+    const std::size_t height = this->configuration_.GetLiveFFTHeight();
+
+    /* texture covers the box and its outline; cleared to the canvas background, which the outline blends over */
+    if (!this->live_canvas_->background.create(width + 2, height + 3)) {
+        throw std::runtime_error("unable to create live plot texture");
+    }
+    this->live_canvas_->background.clear(this->configuration_.GetBackgroundColor());
+    const sf::Transform origin = sf::Transform().translate(1.0f, 1.0f);
+
+    /* box */
+    sf::RectangleShape box(sf::Vector2f(width, height + 1.0f));
+    box.setFillColor(this->configuration_.GetBackgroundColor());
+    box.setOutlineColor(this->configuration_.GetForegroundColor());
+    box.setOutlineThickness(1);
+    this->live_canvas_->background.draw(box, origin);
+
+    /* horizontal guidelines */
+    sf::RectangleShape hline(sf::Vector2f(width, 1.0f));
+    hline.setFillColor(this->configuration_.GetLiveGuidelinesColor());
+    for (const auto& t : this->live_ticks_) {
+        sf::Transform tran;
+        tran.translate(0.0f, (1.0 - std::get<0>(t)) * (height - 1.0f));
+        this->live_canvas_->background.draw(hline, origin * tran);
+    }
+
+    /* vertical guidelines */
+    sf::RectangleShape vline(sf::Vector2f(1.0f, height));
+    vline.setFillColor(this->configuration_.GetLiveGuidelinesColor());
+    for (const auto& t : this->frequency_ticks_) {
+        sf::Transform tran;
+        tran.translate(std::get<0>(t) * (width - 1.0f), 0.0f);
+        this->live_canvas_->background.draw(vline, origin * tran);
     }
+
+    this->live_canvas_->background.display();
 }
 
 void
@@ -513,37 +625,137 @@ Renderer::RenderFFTArea(const std::vector<uint8_t>& memory)
     if (memory.size() != configuration_.GetWidth() * this->fft_count_ * 4) {
         throw std::runtime_error("bad memory size");
     }
+    this->PrepareCanvas();
 
     /* update FFT area texture */
-    this->spectrogram_texture_.update(reinterpret_cast<const uint8_t *>(memory.data()));
+    this->live_canvas_->spectrogram_texture.update(reinterpret_cast<const uint8_t *>(memory.data()));
+    this->spectrogram_head_ = 0;
 
-    /* render FFT area on canvas */
-    this->canvas_.draw(sf::Sprite(this->spectrogram_texture_), this->spectrogram_transform_);
+    this->DrawFFTArea();
 }
 
 void
-Renderer::RenderFFTArea(const std::list<std::vector<uint8_t>>& history)
+Renderer::ScrollFFTArea(std::span<const double> window)
 {
-    if (history.size() != this->fft_count_) {
-        throw std::runtime_error("bad history size");
+    if (window.size() != configuration_.GetWidth()) {
+        throw std::runtime_error("bad window size");
     }
+    this->PrepareCanvas();
+
+    this->live_colors_.resize(window.size() * 4);
+    this->color_map_->Map(window, this->live_colors_);
+
+    /* the row above the head is the oldest one; overwrite it and make it the head */
+    this->spectrogram_head_ = (this->spectrogram_head_ + this->fft_count_ - 1) % this->fft_count_;
+    this->live_canvas_->spectrogram_texture.update(this->live_colors_.data(), this->configuration_.GetWidth(), 1,
+                                      0, this->spectrogram_head_);
+}
 
-    std::vector<uint8_t> memory;
-    memory.resize(this->fft_count_ * this->configuration_.GetWidth() * 4);
+void
+Renderer::DrawFFTArea()
+{
+    int width = this->configuration_.GetWidth();
+    int head = this->spectrogram_head_;
+    int count = this->fft_count_;
+
+    /* rows from head to the end of the texture go on top, wrapped rows below them */
+    this->live_canvas_->canvas.draw(sf::Sprite(this->live_canvas_->spectrogram_texture, sf::IntRect(0, head, width, count - head)),
+                       this->spectrogram_transform_);
+    if (head > 0) {
+        this->live_canvas_->canvas.draw(sf::Sprite(this->live_canvas_->spectrogram_texture, sf::IntRect(0, 0, width, head)),
+                           this->spectrogram_transform_ * sf::Transform().translate(0.0f, count - head));
+    }
+    this->canvas_dirty_ = true;
+}
+
+std::pair<std::size_t, std::size_t>
+Renderer::GetVisibleWindows(std::size_t top, std::size_t height) const
+{
+    auto origin = this->spectrogram_transform_.transformPoint(0.0f, 0.0f);
+    return visible_range(top, top + height, origin.y, this->fft_count_);
+}
+
+void
+Renderer::RenderTile(const History& history, std::size_t left, std::size_t top,
+                     std::size_t width, std::size_t height, std::span<uint8_t> output)
+{
+    if (history.GetRowCount() > this->fft_count_) {
+        throw std::runtime_error("bad history size");
+    }
+    if (history.GetWidth() != this->configuration_.GetWidth()) {
+        throw std::runtime_error("bad history width");
+    }
+    if ((width == 0) || (height == 0) || (left + width > this->width_) || (top + height > this->height_)) {
+        throw std::runtime_error("tile outside of canvas");
+    }
+
+    /* raster over the tile's own area of the canvas */
+    Raster tile(output, left, top, width, height);
+    tile.Clear(this->configuration_.GetBackgroundColor());
+    this->RenderUserInterface(tile);
+
+    /* visible part of the FFT area, with one extra value on each side in case the area is not pixel aligned;
+     * windows not in the history (yet) are left blank */
+    auto origin = this->spectrogram_transform_.transformPoint(0.0f, 0.0f);
+    auto [first_col, last_col] = visible_range(left, left + width, origin.x, this->configuration_.GetWidth());
+    auto [first_row, last_row] = visible_range(top, top + height, origin.y, this->fft_count_);
+    last_row = std::min(last_row, history.GetRowCount());
+
+    if ((first_col < last_col) && (first_row < last_row)) {
+        /* colorize visible values only */
+        std::size_t cols = last_col - first_col;
+        std::size_t rows = last_row - first_row;
+        std::vector<uint8_t> memory(cols * rows * 4);
+        for (std::size_t i = 0; i < rows; i++) {
+            this->color_map_->Map(history.GetRow(first_row + i).subspan(first_col, cols),
+                                  std::span<uint8_t>(memory).subspan(i * cols * 4, cols * 4));
+        }
 
-    std::size_t i = 0;
-    for (auto& win : history) {
-        std::memcpy(reinterpret_cast<void *>(memory.data() + i * this->configuration_.GetWidth() * 4),
-                    reinterpret_cast<const void *>(win.data()),
-                    this->configuration_.GetWidth() * 4);
-        i++;
+        tile.DrawImage(this->spectrogram_transform_ * sf::Transform().translate(first_col, first_row),
+                       cols, rows, memory);
     }
+}
+
+void
+Renderer::RenderStrips(const History& history,
+                       const std::function<void(std::span<const uint8_t>)>& sink)
+{
+    if (!this->configuration_.IsHorizontal()) {
+        /* canvas rows are output rows */
+        std::vector<uint8_t> strip(this->width_ * STRIP_SIZE * 4);
+        for (std::size_t top = 0; top < this->height_; top += STRIP_SIZE) {
+            std::size_t rows = std::min(STRIP_SIZE, this->height_ - top);
+            auto pixels = std::span<uint8_t>(strip).first(this->width_ * rows * 4);
+            this->RenderTile(history, 0, top, this->width_, rows, pixels);
+            sink(pixels);
+        }
+        return;
+    }
+
+    /* output is the canvas rotated 90 degrees counter-clockwise, i.e. output row r is canvas column (width-1-r),
+     * read top to bottom; render bands of canvas columns, right to left, each in tiles of STRIP_SIZE canvas rows
+     * that are rotated into their place in the band */
+    std::vector<uint32_t> tile(BAND_SIZE * STRIP_SIZE);
+    std::vector<uint32_t> band(BAND_SIZE * this->height_);
+    for (std::size_t band_end = this->width_; band_end > 0; ) {
+        std::size_t cols = std::min(BAND_SIZE, band_end);
+        std::size_t left = band_end - cols;
+
+        for (std::size_t top = 0; top < this->height_; top += STRIP_SIZE) {
+            std::size_t rows = std::min(STRIP_SIZE, this->height_ - top);
+            auto pixels = std::span<uint32_t>(tile).first(cols * rows);
+            this->RenderTile(history, left, top, cols, rows,
+                             std::span<uint8_t>(reinterpret_cast<uint8_t *>(pixels.data()), pixels.size() * 4));
+            RotatePixels(pixels, cols, rows, std::span<uint32_t>(band).subspan(top), this->height_);
+        }
 
-    return this->RenderFFTArea(memory);
+        sink(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(band.data()), cols * this->height_ * 4));
+        band_end = left;
+    }
 }
 
-std::vector<uint8_t>
-Renderer::RenderLiveFFT(const RealWindow& window)
+std::span<const uint8_t>
+Renderer::RenderLiveFFT(std::span<const double> window)
 {
     if (window.size() != this->configuration_.GetWidth()) {
         throw std::runtime_error("incorrect window size to be rendered");
@@ -551,39 +763,18 @@ Renderer::RenderLiveFFT(const RealWindow& window)
     if (!this->configuration_.HasLiveWindow()) {
         throw std::runtime_error("asked to render live window for non-live configuration");
     }
+    this->PrepareCanvas();
 
-    std::vector<uint8_t> colors = this->color_map_->Map(window);
-
-    /* FFT live box (so we overwrite old one */
-    sf::RectangleShape fft_live_box(sf::Vector2f(this->configuration_.GetWidth(),
-                                                 this->configuration_.GetLiveFFTHeight() + 1.0f));
-    fft_live_box.setFillColor(this->configuration_.GetBackgroundColor());
-    fft_live_box.setOutlineColor(this->configuration_.GetForegroundColor());
-    fft_live_box.setOutlineThickness(1);
-    this->canvas_.draw(fft_live_box, this->live_transform_);
-
-    /* horizontal live guidelines */
-    for (std::size_t i = 0; i < this->live_ticks_.size(); i ++) {
-        sf::RectangleShape hline(sf::Vector2f(this->configuration_.GetWidth(), 1.0f));
-        hline.setFillColor(this->configuration_.GetLiveGuidelinesColor());
-
-        sf::Transform tran;
-        tran.translate(0.0f, (1.0 - std::get<0>(*std::next(this->live_ticks_.begin(), i))) * (this->configuration_.GetLiveFFTHeight() - 1.0f));
-        this->canvas_.draw(hline, this->live_transform_ * tran);
-    }
+    this->live_colors_.resize(window.size() * 4);
+    this->color_map_->Map(window, this->live_colors_);
+    const auto& colors = this->live_colors_;
 
-    /* vertical live guidelines */
-    for (std::size_t i = 0; i < this->frequency_ticks_.size(); i ++) {
-        sf::RectangleShape vline(sf::Vector2f(1.0f, this->configuration_.GetLiveFFTHeight()));
-        vline.setFillColor(this->configuration_.GetLiveGuidelinesColor());
-
-        sf::Transform tran;
-        tran.translate(std::get<0>(*std::next(this->frequency_ticks_.begin(), i)) * (this->configuration_.GetWidth() - 1.0f), 0.0f);
-        this->canvas_.draw(vline, this->live_transform_ * tran);
-    }
+    /* box and guidelines, covering the old plot */
+    this->live_canvas_->canvas.draw(sf::Sprite(this->live_canvas_->background.getTexture()),
+                       this->live_transform_ * sf::Transform().translate(-1.0f, -1.0f));
 
     /* plot */
-    std::vector<sf::Vertex> vertices;
+    auto& vertices = this->live_vertices_;
     vertices.resize(window.size());
     for (std::size_t i = 0; i < window.size(); i++) {
         double x = i;
@@ -591,15 +782,85 @@ Renderer::RenderLiveFFT(const RealWindow& window)
         vertices[i] = sf::Vertex(sf::Vector2f(x, y),
                                  sf::Color(colors[i * 4 + 0], colors[i * 4 + 1], colors[i * 4 + 2]));
     }
-    this->canvas_.draw(reinterpret_cast<sf::Vertex *>(vertices.data()), vertices.size(),
-                       sf::LineStrip, this->live_transform_);
+    if (sf::VertexBuffer::isAvailable()) {
+        this->live_canvas_->plot.update(vertices.data());
+        this->live_canvas_->canvas.draw(this->live_canvas_->plot, this->live_transform_);
+    } else {
+        this->live_canvas_->canvas.draw(vertices.data(), vertices.size(), sf::LineStrip, this->live_transform_);
+    }
+    this->canvas_dirty_ = true;
 
-    return colors;
+    return this->live_colors_;
 }
 
-sf::Texture
+const sf::Texture&
 Renderer::GetCanvas()
 {
-    this->canvas_.display();
-    return this->canvas_.getTexture();
+    this->PrepareCanvas();
+    if (this->canvas_dirty_) {
+        this->live_canvas_->canvas.display();
+        this->canvas_dirty_ = false;
+    }
+    return this->live_canvas_->canvas.getTexture();
+}
+
+StripStream::StripStream(Renderer& renderer, std::function<void(std::span<const uint8_t>)> sink)
+    : renderer_(renderer)
+    , sink_(std::move(sink))
+    , history_(renderer.GetConfiguration().GetWidth())
+    , next_top_(0)
+    , strip_(renderer.GetWidth() * Renderer::STRIP_SIZE * 4)
+{
+    if (renderer.GetConfiguration().IsHorizontal()) {
+        throw std::runtime_error("horizontal output cannot be streamed");
+    }
+}
+
+void
+StripStream::RenderStrips(bool all)
+{
+    std::size_t width = this->renderer_.GetWidth();
+    std::size_t height = this->renderer_.GetHeight();
+    while (this->next_top_ < height) {
+        std::size_t rows = std::min(Renderer::STRIP_SIZE, height - this->next_top_);
+        auto [first_window, last_window] = this->renderer_.GetVisibleWindows(this->next_top_, rows);
+        if (!all && (last_window > this->history_.GetRowCount())) {
+            /* wait for more windows */
+            return;
+        }
+
+        auto pixels = std::span<uint8_t>(this->strip_).first(width * rows * 4);
+        this->renderer_.RenderTile(this->history_, 0, this->next_top_, width, rows, pixels);
+        this->sink_(pixels);
+        this->next_top_ += rows;
+
+        /* strips only move down, so windows above this one's are no longer needed */
+        this->history_.ReleaseRowsBefore(first_window);
+    }
+}
+
+void
+StripStream::AddRow(std::span<const double> values)
+{
+    if (this->history_.GetRowCount() == this->renderer_.GetFFTCount()) {
+        throw std::runtime_error("more windows than the renderer was created for");
+    }
+    this->history_.AddRow(values);
+    this->RenderStrips(false);
+}
+
+void
+StripStream::Append(const History& rows)
+{
+    if (this->history_.GetRowCount() + rows.GetRowCount() > this->renderer_.GetFFTCount()) {
+        throw std::runtime_error("more windows than the renderer was created for");
+    }
+    this->history_.Append(rows);
+    this->RenderStrips(false);
+}
+
+void
+StripStream::Finish()
+{
+    this->RenderStrips(true);
 }
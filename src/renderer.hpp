@@ -8,9 +8,14 @@
 #define _RENDERER_HPP_
 
 #include "configuration.hpp"
+#include "history.hpp"
+#include "raster.hpp"
 #include <SFML/Graphics.hpp>
+#include <functional>
 #include <vector>
 #include <list>
+#include <span>
+#include <utility>
 
 /* Orientation */
 enum class Orientation {
@@ -20,6 +25,19 @@ enum class Orientation {
     k180
 };
 
+/**
+ * Graphics resources of the live canvas. SFML graphics resources require a
+ * display (and an OpenGL context) as soon as they are constructed, so these
+ * are kept apart from the renderer and only created when the canvas is first
+ * used; file output never creates them.
+ */
+struct LiveCanvas {
+    sf::RenderTexture canvas;
+    sf::Texture spectrogram_texture;    /* circular; rows are displayed starting with Renderer::spectrogram_head_ */
+    sf::VertexBuffer plot;              /* live line plot, updated in place from Renderer::live_vertices_ */
+    sf::RenderTexture background;       /* live plot box and guidelines; one pixel of outline around */
+};
+
 /**
  * Spectrogram rendering class
  */
@@ -29,10 +47,11 @@ protected: /* for all intents and purposes this should be private, but we want t
     const std::size_t fft_count_;       /* number of windows to render */
     const std::unique_ptr<const ColorMap> color_map_; /* color map used for rendering */
 
-    sf::Font font_;
+    RasterFont font_;                   /* axis font, rasterized on the CPU for all output */
 
-    sf::RenderTexture canvas_;
-    sf::Texture spectrogram_texture_;
+    std::unique_ptr<LiveCanvas> live_canvas_; /* allocated, with the UI rendered on it, on first use */
+    std::size_t spectrogram_head_;      /* texture row holding the newest (topmost) window */
+    bool canvas_dirty_;                 /* true if canvas was drawn on since its texture was last retrieved */
 
     std::size_t width_;
     std::size_t height_;
@@ -47,8 +66,23 @@ protected: /* for all intents and purposes this should be private, but we want t
      */
     using AxisTick = std::tuple<double, std::string>;
 
-    std::list<AxisTick> frequency_ticks_;
-    std::list<AxisTick> live_ticks_;
+    /* ticks of each axis, in increasing order of position */
+    std::vector<AxisTick> frequency_ticks_;
+    std::vector<AxisTick> time_ticks_;
+    std::vector<AxisTick> legend_ticks_;
+    std::vector<AxisTick> live_ticks_;
+    std::size_t max_tick_text_length_;  /* longest tick text of any axis */
+
+    /* canvas areas of interface elements, including their tick texts; tiles skip elements they do not overlap */
+    sf::FloatRect legend_area_;
+    sf::FloatRect live_area_;
+    sf::FloatRect frequency_axis_area_;
+
+    std::vector<uint8_t> legend_gradient_;  /* RGBA values of legend, one row */
+
+    /* live plot buffers, reused between windows */
+    std::vector<uint8_t> live_colors_;
+    std::vector<sf::Vertex> live_vertices_;
 
     /**
      * Return a short representation of the value (using unit prefixes like, m, k, M ...).
@@ -96,17 +130,35 @@ protected: /* for all intents and purposes this should be private, but we want t
                                      unsigned int length_px, unsigned int min_tick_length_px, bool rotated);
 
     /**
-     * Render an axis upon a texture
-     * @param texture Texture to render to.
+     * Render an axis upon a raster. Ticks outside of the raster window are skipped,
+     * without visiting them.
+     * @param target Raster to render to.
      * @param t Transform to use.
      * @param lhs True if has left-hand side text.
      * @param orientation One of Orientation.
      * @param length Length in pixels.
-     * @param ticks Ticks.
+     * @param ticks Ticks, in increasing order of position.
      */
-    void RenderAxis(sf::RenderTexture& texture,
+    void RenderAxis(Raster& target,
                     const sf::Transform& t, bool lhs, Orientation orientation, double length,
-                    const std::list<AxisTick>& ticks);
+                    std::span<const AxisTick> ticks);
+
+    /**
+     * Render axes, legend and boxes upon a raster, in canvas coordinates.
+     * @param target Raster to render to.
+     */
+    void RenderUserInterface(Raster& target);
+
+    /**
+     * Allocate the canvas and render the UI on it, if not already done.
+     */
+    void PrepareCanvas();
+
+    /**
+     * Render the static part of the live plot (box and guidelines) into the
+     * live canvas.
+     */
+    void RenderLiveBackground();
 
 public:
     Renderer() = delete;
@@ -119,20 +171,151 @@ public:
     void RenderFFTArea(const std::vector<uint8_t>& memory);
 
     /**
-     * Render the spectrogram area.
-     * @param history List of RGBA colorized windows.
+     * Scroll the spectrogram area down by one window and colorize a new
+     * window on top. Only the new window is uploaded to the area texture,
+     * which is used as a ring buffer; the canvas is not drawn on until
+     * DrawFFTArea(), so several windows can be added at the cost of one draw.
+     * @param window Window values, real, scaled.
+     */
+    void ScrollFFTArea(std::span<const double> window);
+
+    /**
+     * Render the spectrogram area texture on the canvas, unrolling the ring.
+     */
+    void DrawFFTArea();
+
+    /* number of output rows rendered at once by RenderStrips() */
+    static constexpr std::size_t STRIP_SIZE = 256;
+    /* number of canvas columns rendered at once by RenderStrips(), for horizontal output */
+    static constexpr std::size_t BAND_SIZE = 16;
+    /**
+     * @param top Top edge of a band of the canvas.
+     * @param height Height of the band.
+     * @return Range [first, last) of windows visible in the band.
+     */
+    std::pair<std::size_t, std::size_t> GetVisibleWindows(std::size_t top, std::size_t height) const;
+
+    /**
+     * Render an area of the spectrogram, colorizing it in the process. The
+     * area is rasterized on the CPU, without using the canvas or any graphics
+     * context, so output can be rendered on headless machines and is not
+     * limited by the maximum texture size.
+     * @param history Displayed windows, one row each; may hold fewer windows
+     *                than the renderer, in which case the missing ones are
+     *                left blank. Windows visible in the area must not have
+     *                been released.
+     * @param left Left edge of area, in canvas coordinates.
+     * @param top Top edge of area, in canvas coordinates.
+     * @param width Width of area.
+     * @param height Height of area.
+     * @param output Receives the RGBA values of the area, row by row, not
+     *               rotated; must hold exactly width * height pixels.
+     */
+    void RenderTile(const History& history, std::size_t left, std::size_t top,
+                    std::size_t width, std::size_t height, std::span<uint8_t> output);
+
+    /**
+     * Render the whole spectrogram, in output orientation (i.e. rotated if
+     * horizontal), handing it out in strips of rows, top to bottom.
+     * @param history Displayed windows, one row each.
+     * @param sink Receives the RGBA values of one or more whole output rows;
+     *             the values are valid only during the call.
+     *
+     * NOTE: Besides the history, memory use is bounded by the strip size.
+     *       Horizontal output is rendered in tiles of BAND_SIZE canvas
+     *       columns by STRIP_SIZE canvas rows, but a strip holds BAND_SIZE
+     *       whole output rows, which are as long as the history.
+     */
+    void RenderStrips(const History& history,
+                      const std::function<void(std::span<const uint8_t>)>& sink);
+
+    /**
+     * Render the live plot of a window.
+     * @param window Window values, real, scaled.
+     * @return View of the colorized window, valid until the next call to
+     *         this method or to ScrollFFTArea().
+     */
+    std::span<const uint8_t> RenderLiveFFT(std::span<const double> window);
+
+    /**
+     * Flush drawing done on the canvas since the last call.
+     * @return The rendered canvas texture, owned by the renderer; stays valid
+     *         (and is updated in place) for the lifetime of the renderer.
      */
-    void RenderFFTArea(const std::list<std::vector<uint8_t>>& history);
-    std::vector<uint8_t> RenderLiveFFT(const RealWindow& window);
+    const sf::Texture& GetCanvas();
 
     /**
-     * @return The rendered canvas texture.
+     * @return True if the canvas was drawn on since the last GetCanvas() call.
      */
-    sf::Texture GetCanvas();
+    bool IsCanvasDirty() const { return canvas_dirty_; }
+
+    const Configuration& GetConfiguration() const { return configuration_; }
+    auto GetFFTCount() const { return fft_count_; }
 
     /* size getters */
     auto GetWidth() const { return width_; }
     auto GetHeight() const { return height_; }
+    auto GetOutputWidth() const { return configuration_.IsHorizontal() ? height_ : width_; }
+    auto GetOutputHeight() const { return configuration_.IsHorizontal() ? width_ : height_; }
+};
+
+/**
+ * Renders a vertical spectrogram while its windows are being computed,
+ * handing out each strip of output rows as soon as all windows visible in it
+ * are known. Only the windows of the strip being filled are kept, so memory
+ * use does not depend on the number of windows.
+ *
+ * NOTE: Horizontal output can not be streamed, since each of its rows spans
+ *       all windows.
+ */
+class StripStream {
+private:
+    Renderer& renderer_;
+    std::function<void(std::span<const uint8_t>)> sink_;
+    History history_;               /* windows added so far, released once rendered */
+    std::size_t next_top_;          /* top canvas row of the next strip */
+    std::vector<uint8_t> strip_;
+
+    /**
+     * Render strips while all their windows are available.
+     * @param all Render the remaining strips regardless, leaving missing
+     *            windows blank.
+     */
+    void RenderStrips(bool all);
+
+public:
+    StripStream() = delete;
+
+    /**
+     * @param renderer Renderer of the whole spectrogram; must not be
+     *                 horizontal.
+     * @param sink Receives the RGBA values of one or more whole output rows,
+     *             top to bottom; the values are valid only during the call.
+     */
+    StripStream(Renderer& renderer, std::function<void(std::span<const uint8_t>)> sink);
+
+    /**
+     * Add the next displayed window.
+     * @param values Values in the [0..1] domain.
+     */
+    void AddRow(std::span<const double> values);
+
+    /**
+     * Add the next displayed windows.
+     * @param rows Windows to append, in order.
+     */
+    void Append(const History& rows);
+
+    /**
+     * Render the remaining strips. If fewer windows than the renderer's count
+     * were added, the missing ones are left blank.
+     */
+    void Finish();
+
+    /**
+     * @return Number of windows added so far.
+     */
+    auto GetRowCount() const { return history_.GetRowCount(); }
 };
 
 #endif
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "sample-conversion.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPECGRAM_X86_KERNELS
+#endif
+
+/* 64-bit integers have no packed conversion to double below AVX-512; they always go through the scalar kernel */
+template <class T>
+static constexpr bool kHasVectorKernel = !(std::is_integral_v<T> && sizeof(T) == 8);
+
+/**
+ * Scalar kernel; also used for the tails of the vector kernels.
+ * @param in Raw samples.
+ * @param begin Index of first sample to convert.
+ * @param end Index past the last sample to convert.
+ * @param scale Factor applied to each sample.
+ * @param out Output, as interleaved real and imaginary parts.
+ */
+template <class T, class O, bool C>
+static void
+convert_scalar(const T *in, std::size_t begin, std::size_t end, double scale, O *out)
+{
+    for (std::size_t i = begin; i < end; i++) {
+        double value = (double)in[i];
+        if constexpr (std::is_floating_point_v<T>) {
+            /* remove NaNs */
+            value = std::isnan(in[i]) ? 0.0 : value;
+        }
+        if constexpr (C) {
+            out[i] = static_cast<O>(value * scale);
+        } else {
+            out[2 * i] = static_cast<O>(value * scale);
+            out[2 * i + 1] = 0.0;
+        }
+    }
+}
+
+#ifdef SPECGRAM_X86_KERNELS
+
+/**
+ * Loads four samples as doubles, using SSE2.
+ * @param p Samples.
+ * @param a Receives samples 0 and 1.
+ * @param b Receives samples 2 and 3.
+ */
+template <class T>
+static inline void
+load4_sse2(const T *p, __m128d& a, __m128d& b)
+{
+    if constexpr (std::is_same_v<T, float>) {
+        __m128 x = _mm_loadu_ps(p);
+        a = _mm_cvtps_pd(x);
+        b = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+        /* remove NaNs; a NaN is the only value not ordered with itself */
+        a = _mm_and_pd(a, _mm_cmpord_pd(a, a));
+        b = _mm_and_pd(b, _mm_cmpord_pd(b, b));
+    } else if constexpr (std::is_same_v<T, double>) {
+        a = _mm_loadu_pd(p);
+        b = _mm_loadu_pd(p + 2);
+        a = _mm_and_pd(a, _mm_cmpord_pd(a, a));
+        b = _mm_and_pd(b, _mm_cmpord_pd(b, b));
+    } else {
+        /* widen to four 32-bit integers */
+        const __m128i zero = _mm_setzero_si128();
+        __m128i x;
+        if constexpr (sizeof(T) == 1) {
+            std::int32_t raw;
+            std::memcpy(&raw, p, sizeof(raw));
+            x = _mm_cvtsi32_si128(raw);
+            if constexpr (std::is_signed_v<T>) {
+                x = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+                x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            } else {
+                x = _mm_unpacklo_epi16(_mm_unpacklo_epi8(x, zero), zero);
+            }
+        } else if constexpr (sizeof(T) == 2) {
+            x = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+            if constexpr (std::is_signed_v<T>) {
+                x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+            } else {
+                x = _mm_unpacklo_epi16(x, zero);
+            }
+        } else {
+            x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            if constexpr (!std::is_signed_v<T>) {
+                /* convert as signed, offset by 2^31 */
+                x = _mm_xor_si128(x, _mm_set1_epi32(std::numeric_limits<std::int32_t>::min()));
+            }
+        }
+
+        a = _mm_cvtepi32_pd(x);
+        b = _mm_cvtepi32_pd(_mm_srli_si128(x, 8));
+        if constexpr (sizeof(T) == 4 && !std::is_signed_v<T>) {
+            a = _mm_add_pd(a, _mm_set1_pd(2147483648.0));
+            b = _mm_add_pd(b, _mm_set1_pd(2147483648.0));
+        }
+    }
+}
+
+/**
+ * Stores four converted samples (starting at sample i) in double precision, using SSE2.
+ */
+template <bool C>
+static inline void
+store4_sse2(double *out, std::size_t i, __m128d a, __m128d b)
+{
+    if constexpr (C) {
+        _mm_storeu_pd(out + i, a);
+        _mm_storeu_pd(out + i + 2, b);
+    } else {
+        /* interleave with zero imaginary parts */
+        const __m128d zero = _mm_setzero_pd();
+        _mm_storeu_pd(out + 2 * i, _mm_unpacklo_pd(a, zero));
+        _mm_storeu_pd(out + 2 * i + 2, _mm_unpackhi_pd(a, zero));
+        _mm_storeu_pd(out + 2 * i + 4, _mm_unpacklo_pd(b, zero));
+        _mm_storeu_pd(out + 2 * i + 6, _mm_unpackhi_pd(b, zero));
+    }
+}
+
+/**
+ * Stores four converted samples (starting at sample i) in single precision, using SSE2.
+ */
+template <bool C>
+static inline void
+store4_sse2(float *out, std::size_t i, __m128d a, __m128d b)
+{
+    __m128 v = _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b));
+    if constexpr (C) {
+        _mm_storeu_ps(out + i, v);
+    } else {
+        /* interleave with zero imaginary parts */
+        const __m128 zero = _mm_setzero_ps();
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(v, zero));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(v, zero));
+    }
+}
+
+/**
+ * SSE2 kernel; converts whole groups of four samples.
+ * @return Number of samples converted.
+ */
+template <class T, class O, bool C>
+static std::size_t
+convert_sse2(const T *in, std::size_t count, double scale, O *out)
+{
+    const __m128d s = _mm_set1_pd(scale);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128d a, b;
+        load4_sse2(in + i, a, b);
+        store4_sse2<C>(out, i, _mm_mul_pd(a, s), _mm_mul_pd(b, s));
+    }
+    return i;
+}
+
+/**
+ * Loads eight samples as doubles, using AVX2.
+ * @param p Samples.
+ * @param a Receives samples 0 to 3.
+ * @param b Receives samples 4 to 7.
+ */
+template <class T>
+__attribute__((target("avx2"))) static inline void
+load8_avx2(const T *p, __m256d& a, __m256d& b)
+{
+    if constexpr (std::is_same_v<T, float>) {
+        __m256 x = _mm256_loadu_ps(p);
+        a = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+        b = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+        a = _mm256_and_pd(a, _mm256_cmp_pd(a, a, _CMP_ORD_Q));
+        b = _mm256_and_pd(b, _mm256_cmp_pd(b, b, _CMP_ORD_Q));
+    } else if constexpr (std::is_same_v<T, double>) {
+        a = _mm256_loadu_pd(p);
+        b = _mm256_loadu_pd(p + 4);
+        a = _mm256_and_pd(a, _mm256_cmp_pd(a, a, _CMP_ORD_Q));
+        b = _mm256_and_pd(b, _mm256_cmp_pd(b, b, _CMP_ORD_Q));
+    } else {
+        /* widen to eight 32-bit integers */
+        __m256i x;
+        if constexpr (sizeof(T) == 1) {
+            __m128i r = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+            x = std::is_signed_v<T> ? _mm256_cvtepi8_epi32(r) : _mm256_cvtepu8_epi32(r);
+        } else if constexpr (sizeof(T) == 2) {
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            x = std::is_signed_v<T> ? _mm256_cvtepi16_epi32(r) : _mm256_cvtepu16_epi32(r);
+        } else {
+            x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            if constexpr (!std::is_signed_v<T>) {
+                /* convert as signed, offset by 2^31 */
+                x = _mm256_xor_si256(x, _mm256_set1_epi32(std::numeric_limits<std::int32_t>::min()));
+            }
+        }
+
+        a = _mm256_cvtepi32_pd(_mm256_castsi256_si128(x));
+        b = _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+        if constexpr (sizeof(T) == 4 && !std::is_signed_v<T>) {
+            a = _mm256_add_pd(a, _mm256_set1_pd(2147483648.0));
+            b = _mm256_add_pd(b, _mm256_set1_pd(2147483648.0));
+        }
+    }
+}
+
+/**
+ * Stores four real values as complex values with zero imaginary parts, using AVX2.
+ */
+__attribute__((target("avx2"))) static inline void
+store4_real_avx2(double *out, __m256d v)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d lo = _mm256_unpacklo_pd(v, zero);   /* v0 0 v2 0 */
+    __m256d hi = _mm256_unpackhi_pd(v, zero);   /* v1 0 v3 0 */
+    _mm256_storeu_pd(out, _mm256_permute2f128_pd(lo, hi, 0x20));
+    _mm256_storeu_pd(out + 4, _mm256_permute2f128_pd(lo, hi, 0x31));
+}
+
+/**
+ * Stores eight converted samples (starting at sample i) in double precision, using AVX2.
+ */
+template <bool C>
+__attribute__((target("avx2"))) static inline void
+store8_avx2(double *out, std::size_t i, __m256d a, __m256d b)
+{
+    if constexpr (C) {
+        _mm256_storeu_pd(out + i, a);
+        _mm256_storeu_pd(out + i + 4, b);
+    } else {
+        store4_real_avx2(out + 2 * i, a);
+        store4_real_avx2(out + 2 * i + 8, b);
+    }
+}
+
+/**
+ * Stores eight converted samples (starting at sample i) in single precision, using AVX2.
+ */
+template <bool C>
+__attribute__((target("avx2"))) static inline void
+store8_avx2(float *out, std::size_t i, __m256d a, __m256d b)
+{
+    __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(a)), _mm256_cvtpd_ps(b), 1);
+    if constexpr (C) {
+        _mm256_storeu_ps(out + i, v);
+    } else {
+        /* interleave with zero imaginary parts */
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 lo = _mm256_unpacklo_ps(v, zero);    /* v0 0 v1 0 v4 0 v5 0 */
+        __m256 hi = _mm256_unpackhi_ps(v, zero);    /* v2 0 v3 0 v6 0 v7 0 */
+        _mm256_storeu_ps(out + 2 * i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(out + 2 * i + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+}
+
+/**
+ * AVX2 kernel; converts whole groups of eight samples.
+ * @return Number of samples converted.
+ */
+template <class T, class O, bool C>
+__attribute__((target("avx2"))) static std::size_t
+convert_avx2(const T *in, std::size_t count, double scale, O *out)
+{
+    const __m256d s = _mm256_set1_pd(scale);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256d a, b;
+        load8_avx2(in + i, a, b);
+        store8_avx2<C>(out, i, _mm256_mul_pd(a, s), _mm256_mul_pd(b, s));
+    }
+    return i;
+}
+
+#endif
+
+template <class T, class O, bool C>
+static void
+convert(const T *in, std::size_t count, double scale, O *out, SimdLevel level)
+{
+    std::size_t done = 0;
+#ifdef SPECGRAM_X86_KERNELS
+    if constexpr (kHasVectorKernel<T>) {
+        if (level == SimdLevel::kAVX2) {
+            done = convert_avx2<T, O, C>(in, count, scale, out);
+        } else if (level == SimdLevel::kSSE2) {
+            done = convert_sse2<T, O, C>(in, count, scale, out);
+        }
+    }
+#endif
+    convert_scalar<T, O, C>(in, done, count, scale, out);
+}
+
+SimdLevel
+GetSupportedSimdLevel()
+{
+#ifdef SPECGRAM_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::kAVX2;
+    }
+    /* baseline for x86-64 */
+    return SimdLevel::kSSE2;
+#else
+    return SimdLevel::kNone;
+#endif
+}
+
+template <class T, class O>
+void
+ConvertSamples(std::span<const T> input, bool is_complex, double scale, std::span<std::complex<O>> output,
+               SimdLevel level)
+{
+    static const SimdLevel supported = GetSupportedSimdLevel();
+    assert(output.size() * (is_complex ? 2 : 1) >= input.size());
+    level = std::min(level, supported);
+
+    /* std::complex<O> is guaranteed to be laid out as O[2] */
+    auto out = reinterpret_cast<O *>(output.data());
+    if (is_complex) {
+        convert<T, O, true>(input.data(), input.size(), scale, out, level);
+    } else {
+        convert<T, O, false>(input.data(), input.size(), scale, out, level);
+    }
+}
+
+#define INSTANTIATE_CONVERT_SAMPLES(T) \
+    template void ConvertSamples<T, float>(std::span<const T>, bool, double, std::span<std::complex<float>>, \
+                                           SimdLevel); \
+    template void ConvertSamples<T, double>(std::span<const T>, bool, double, std::span<std::complex<double>>, \
+                                            SimdLevel);
+
+INSTANTIATE_CONVERT_SAMPLES(int8_t)
+INSTANTIATE_CONVERT_SAMPLES(int16_t)
+INSTANTIATE_CONVERT_SAMPLES(int32_t)
+INSTANTIATE_CONVERT_SAMPLES(int64_t)
+
+INSTANTIATE_CONVERT_SAMPLES(uint8_t)
+INSTANTIATE_CONVERT_SAMPLES(uint16_t)
+INSTANTIATE_CONVERT_SAMPLES(uint32_t)
+INSTANTIATE_CONVERT_SAMPLES(uint64_t)
+
+INSTANTIATE_CONVERT_SAMPLES(float)
+INSTANTIATE_CONVERT_SAMPLES(double)
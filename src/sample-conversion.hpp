@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _SAMPLE_CONVERSION_HPP_
+#define _SAMPLE_CONVERSION_HPP_
+
+#include <complex>
+#include <span>
+
+/**
+ * Instruction set extensions used by the sample conversion kernels.
+ */
+enum class SimdLevel {
+    kNone,
+    kSSE2,
+    kAVX2
+};
+
+/**
+ * @return Best instruction set extension supported by the running CPU.
+ */
+SimdLevel GetSupportedSimdLevel();
+
+/**
+ * Converts raw samples to complex values, multiplying them by a scale factor.
+ * @tparam T Raw sample type.
+ * @tparam O Precision of output values (float or double).
+ * @param input Raw samples; for complex input, real and imaginary parts are
+ *              interleaved.
+ * @param is_complex If true, two input samples make up each output value.
+ * @param scale Factor applied to each sample.
+ * @param output Window that receives the converted values; must hold at least
+ *               input.size() (or half that, for complex input) values.
+ * @param level Kernel to use; levels the CPU does not support fall back to the
+ *              best supported one.
+ *
+ * NOTE: For floating point samples, NaNs are replaced by zero.
+ * NOTE: Scaling is always done in double precision; single precision output
+ *       is rounded afterwards.
+ */
+template <class T, class O>
+void ConvertSamples(std::span<const T> input, bool is_complex, double scale, std::span<std::complex<O>> output,
+                    SimdLevel level);
+
+/**
+ * Converts raw samples to complex values, using the best kernel supported by
+ * the running CPU.
+ */
+template <class T, class O>
+void ConvertSamples(std::span<const T> input, bool is_complex, double scale, std::span<std::complex<O>> output)
+{
+    static const SimdLevel level = GetSupportedSimdLevel();
+    ConvertSamples<T, O>(input, is_complex, scale, output, level);
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "slot-queue.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+template <class T>
+SlotQueue<T>::SlotQueue(std::size_t slot_size, std::size_t depth)
+    : slot_size_(slot_size), depth_(depth), head_(0), tail_(0), overruns_(0), high_water_(0), stalled_(false)
+{
+    if (slot_size == 0) {
+        throw std::runtime_error("slot size must be positive");
+    }
+    if (depth == 0) {
+        throw std::runtime_error("queue depth must be positive");
+    }
+    this->storage_.resize(slot_size * depth);
+}
+
+template <class T>
+std::optional<std::span<T>>
+SlotQueue<T>::AcquireWrite()
+{
+    auto head = this->head_.load(std::memory_order_relaxed);
+    auto tail = this->tail_.load(std::memory_order_acquire);
+    assert(head - tail <= this->depth_);
+
+    if (head - tail == this->depth_) {
+        if (!this->stalled_) {
+            this->overruns_.fetch_add(1, std::memory_order_relaxed);
+            this->stalled_ = true;
+        }
+        return {};
+    }
+
+    this->stalled_ = false;
+    return std::span<T>(this->storage_.data() + (head % this->depth_) * this->slot_size_, this->slot_size_);
+}
+
+template <class T>
+void
+SlotQueue<T>::Push()
+{
+    auto head = this->head_.load(std::memory_order_relaxed) + 1;
+    this->head_.store(head, std::memory_order_release);
+
+    auto used = head - this->tail_.load(std::memory_order_acquire);
+    if (used > this->high_water_.load(std::memory_order_relaxed)) {
+        this->high_water_.store(used, std::memory_order_relaxed);
+    }
+}
+
+template <class T>
+std::optional<std::span<const T>>
+SlotQueue<T>::Front() const
+{
+    auto tail = this->tail_.load(std::memory_order_relaxed);
+    auto head = this->head_.load(std::memory_order_acquire);
+    if (head == tail) {
+        return {};
+    }
+    return std::span<const T>(this->storage_.data() + (tail % this->depth_) * this->slot_size_, this->slot_size_);
+}
+
+template <class T>
+void
+SlotQueue<T>::Pop()
+{
+    auto tail = this->tail_.load(std::memory_order_relaxed);
+    assert(tail != this->head_.load(std::memory_order_acquire));
+    this->tail_.store(tail + 1, std::memory_order_release);
+}
+
+template <class T>
+std::size_t
+SlotQueue<T>::GetSize() const
+{
+    auto tail = this->tail_.load(std::memory_order_acquire);
+    auto head = this->head_.load(std::memory_order_acquire);
+    return head - tail;
+}
+
+template class SlotQueue<char>;
+template class SlotQueue<double>;
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#ifndef _SLOT_QUEUE_HPP_
+#define _SLOT_QUEUE_HPP_
+
+#include <atomic>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * Lock-free, single-producer/single-consumer queue of fixed-size slots.
+ *
+ * Slots live in one contiguous allocation and are handed out as views, so
+ * the producer writes in place and the consumer reads in place; no element is
+ * ever copied by the queue itself.
+ */
+template <class T>
+class SlotQueue {
+private:
+    const std::size_t slot_size_;       /* number of elements in a slot */
+    const std::size_t depth_;           /* number of slots */
+    std::vector<T> storage_;            /* depth_ * slot_size_ elements */
+
+    /* monotonic slot counters; index in storage is counter % depth_ */
+    alignas(64) std::atomic<std::size_t> head_;     /* next slot to be written, owned by producer */
+    alignas(64) std::atomic<std::size_t> tail_;     /* next slot to be read, owned by consumer */
+
+    /* statistics, written by producer only */
+    alignas(64) std::atomic<std::size_t> overruns_;     /* number of times producer found the queue full */
+    std::atomic<std::size_t> high_water_;               /* maximum number of slots ever in use */
+    bool stalled_;                                      /* producer found the queue full on last attempt */
+
+public:
+    SlotQueue() = delete;
+    SlotQueue(const SlotQueue&) = delete;
+    SlotQueue(SlotQueue&&) = delete;
+    SlotQueue & operator=(const SlotQueue&) = delete;
+
+    /**
+     * @param slot_size Number of elements in each slot.
+     * @param depth Number of slots in queue.
+     */
+    SlotQueue(std::size_t slot_size, std::size_t depth);
+
+    /**
+     * Producer side: retrieve the next free slot.
+     * @return View of the slot, or nothing if the queue is full.
+     *
+     * NOTE: Finding the queue full counts as one overrun, no matter how many
+     *       times the producer retries until a slot is freed.
+     */
+    std::optional<std::span<T>> AcquireWrite();
+
+    /**
+     * Producer side: publish the slot previously retrieved with AcquireWrite().
+     */
+    void Push();
+
+    /**
+     * Consumer side: retrieve the oldest published slot.
+     * @return View of the slot, or nothing if the queue is empty.
+     */
+    std::optional<std::span<const T>> Front() const;
+
+    /**
+     * Consumer side: release the slot previously retrieved with Front().
+     */
+    void Pop();
+
+    /**
+     * @return Number of published slots not yet released.
+     */
+    std::size_t GetSize() const;
+
+    auto GetSlotSize() const { return slot_size_; }
+    auto GetDepth() const { return depth_; }
+    std::size_t GetOverrunCount() const { return overruns_.load(std::memory_order_relaxed); }
+    std::size_t GetHighWaterMark() const { return high_water_.load(std::memory_order_relaxed); }
+};
+
+#endif
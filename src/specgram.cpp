@@ -7,28 +7,36 @@
 #include "configuration.hpp"
 #include "input-parser.hpp"
 #include "input-reader.hpp"
-#include "color-map.hpp"
 #include "value-map.hpp"
 #include "window-function.hpp"
 #include "fft.hpp"
+#include "history.hpp"
 #include "live.hpp"
+#include "png-writer.hpp"
+#include "slot-queue.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <csignal>
-#include <list>
-#include <random>
+#include <cctype>
+#include <optional>
 #include <cstdio>
 #include <cassert>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <exception>
+#include <functional>
+#include <type_traits>
 
 /* main loop exit condition */
-volatile bool main_loop_running = true;
-
-/* temporary output file name */
-std::string temp_file_name = "";
+std::atomic<bool> main_loop_running = true;
 
 /*
  * logger - logging is minimal and only happens in this file
@@ -58,8 +66,9 @@ sigint_handler(int)
 /*
  * printing functions
  */
+template <class P>
 void
-print_complex_window(const std::string& name, const ComplexWindow& window)
+print_complex_window(const std::string& name, std::span<const std::complex<P>> window)
 {
     std::cout << name << ": [";
     for (const auto& v : window) {
@@ -69,8 +78,9 @@ print_complex_window(const std::string& name, const ComplexWindow& window)
     std::cout << "]" << std::endl;
 }
 
+template <class P>
 void
-print_real_window(const std::string& name, const RealWindow& window)
+print_real_window(const std::string& name, std::span<const P> window)
 {
     std::cout << name << ": [";
     for (const auto& v : window) {
@@ -80,103 +90,464 @@ print_real_window(const std::string& name, const RealWindow& window)
 }
 
 /*
- * generate a random string (see https://stackoverflow.com/a/50556436)
+ * render spectrogram to a stream, in PNG format. The image is encoded strip by strip, while rendering, so it is
+ * never held in memory as a whole.
  */
-std::string
-generate_random_string(std::size_t length)
+void
+write_png(Renderer& renderer, const History& history, std::ostream& stream, int compression_level)
 {
-    std::mt19937 generator { std::random_device{}() };
-    std::uniform_int_distribution<int> distribution { 'a', 'z' };
+    PngWriter png(stream, renderer.GetOutputWidth(), renderer.GetOutputHeight(), compression_level);
+    renderer.RenderStrips(history, [&png](std::span<const uint8_t> rows) { png.WriteRows(rows); });
+    png.Finish();
+}
 
-    std::string output(length, '\0');
-    for(auto& ch : output) {
-        ch = static_cast<char>(distribution(generator) & 0xff);
-    }
+/*
+ * true if an output file name has a PNG extension; such files are encoded by us, strip by strip, while other
+ * formats are left to SFML
+ */
+bool
+is_png_filename(const std::string& filename)
+{
+    auto extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == ".png";
+}
 
-    return output;
+/*
+ * render spectrogram to an image file. PNG files are streamed (see write_png()); other formats are left to SFML.
+ */
+void
+save_image(Renderer& renderer, const History& history, const std::string& filename, int compression_level)
+{
+    if (is_png_filename(filename)) {
+        std::ofstream file(filename, std::ios::out | std::ios::binary);
+        if (file.fail()) {
+            throw std::runtime_error("cannot open output file " + filename);
+        }
+        write_png(renderer, history, file, compression_level);
+    } else {
+        std::size_t width = renderer.GetOutputWidth();
+        std::size_t height = renderer.GetOutputHeight();
+        std::vector<uint8_t> pixels;
+        pixels.reserve(width * height * 4);
+        renderer.RenderStrips(history, [&pixels](std::span<const uint8_t> rows) {
+            pixels.insert(pixels.end(), rows.begin(), rows.end());
+        });
+
+        sf::Image image;
+        image.create(width, height, pixels.data());
+        if (!image.saveToFile(filename)) {
+            throw std::runtime_error("cannot save output file " + filename);
+        }
+    }
 }
 
 /*
- * dump image to stdout (in PNG format). This writes a temp file in /dev/shm since SFML cannot save to memory.
+ * dump spectrogram to stdout (in PNG format), encoding it straight into the stream
  */
 void
-dump_to_stdout(const sf::Image& image)
+dump_to_stdout(Renderer& renderer, const History& history, int compression_level)
+{
+    /* if using STDIN for input, we're here from a SIGINT, and the reader at the other end of the pipe may be gone
+     * as well; a SIGPIPE is expected, so exit quietly when it comes */
+    std::signal(SIGPIPE, [](int) { /* no logger, no checks */ std::_Exit(0); });
+
+    write_png(renderer, history, std::cout, compression_level);
+}
+
+/*
+ * path of the FFTW wisdom cache for precision P; FFTW keeps separate wisdom for each precision, so we mirror its
+ * system-wide naming (wisdom, wisdomf). Returns an empty path if no cache directory can be determined.
+ */
+template <class P>
+std::filesystem::path
+get_wisdom_filename()
+{
+    std::filesystem::path cache_dir;
+    if (const char *xdg_cache = std::getenv("XDG_CACHE_HOME"); xdg_cache != nullptr && *xdg_cache != '\0') {
+        cache_dir = xdg_cache;
+    } else if (const char *home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+        cache_dir = std::filesystem::path(home) / ".cache";
+    } else {
+        return {};
+    }
+    return cache_dir / "specgram" / (std::is_same_v<P, float> ? "wisdomf" : "wisdom");
+}
+
+/*
+ * buffers for every stage of turning FFT output into a displayed window; these are allocated once, so that the
+ * steady state processing loop does not allocate
+ */
+template <class P>
+struct Workspace {
+    BasicComplexWindow<P> fft_values;   /* FFT output, for a whole batch of windows */
+    BasicRealWindow<P> magnitude;       /* magnitude of one FFT output window */
+    BasicRealWindow<P> normalized;      /* magnitude, mapped to [0..1] */
+    BasicRealWindow<P> mirrored;        /* normalized magnitude, mirrored to the full spectrum (real input only) */
+    BasicRealWindow<P> display;         /* resampled or cropped to display width */
+    RealWindow window_sum;              /* running average of displayed windows */
+    std::size_t window_sum_count;       /* number of windows in running average */
+    std::unique_ptr<BasicResamplePlan<P>> resample_plan; /* resampling weights, if resampling */
+
+    Workspace(const Configuration& conf, const BasicFFT<P>& fft)
+        : fft_values(fft.GetBatchSize() * fft.GetOutputWidth()), magnitude(fft.GetOutputWidth()),
+          normalized(fft.GetOutputWidth()), mirrored(fft.IsRealInput() ? conf.GetFFTWidth() : 0),
+          display(conf.GetWidth()), window_sum(conf.GetWidth(), 0.0), window_sum_count(0)
+    {
+        if (conf.CanResample()) {
+            resample_plan = std::make_unique<BasicResamplePlan<P>>(conf.GetFFTWidth(), conf.GetRate(),
+                                                                   conf.GetWidth(), conf.GetMinFreq(),
+                                                                   conf.GetMaxFreq(), conf.GetFrequencyReduction());
+        }
+    }
+
+    /**
+     * @return View of the i-th FFT output window in fft_values.
+     */
+    std::span<const std::complex<P>> GetFFTWindow(const BasicFFT<P>& fft, std::size_t i) const
+    {
+        return std::span<const std::complex<P>>(fft_values).subspan(i * fft.GetOutputWidth(), fft.GetOutputWidth());
+    }
+};
+
+/*
+ * compute the magnitude of a FFT output window, map it to [0..1] and bring it to display width, then add it to the
+ * running average in the workspace. Returns true if ws.window_sum holds a complete average (of
+ * conf.GetAverageCount() windows); the next call starts a new average.
+ */
+template <class P>
+bool
+accumulate_fft_window(const Configuration& conf, BasicValueMap<P>& value_map,
+                      std::span<const std::complex<P>> fft_values, Workspace<P>& ws)
 {
-    static constexpr size_t TEMP_BUFFER_SIZE = 1024;
-    static constexpr size_t TEMP_FILENAME_LENGTH = 32;
+    bool real_input = !conf.HasComplexInput();
+    if (conf.MustPrintFFT()) {
+        print_complex_window<P>("fft", fft_values);
+    }
 
-    /* save */
-    temp_file_name = "/dev/shm/" + generate_random_string(TEMP_FILENAME_LENGTH) + ".png";
-    INFO("Temporary file: " << temp_file_name);
-    image.saveToFile(temp_file_name);
+    /* on a decibel scale, compute magnitude and map it to [0..1] domain in a single pass, from the power of each
+     * term; aliasing sums the magnitudes of distinct terms, which only reduces to a gain for real input. The single
+     * pass computes levels in single precision, so it is only used when processing in single precision */
+    auto decibel_map = dynamic_cast<const DecibelValueMap<P> *>(&value_map);
+    if (std::is_same_v<P, float> && decibel_map != nullptr && (real_input || !conf.IsAliasingNegativeFrequencies())
+        && (decibel_map->GetLowerBound() < decibel_map->GetUpperBound())) {
+        std::span<P> normalized = ws.normalized;
+        if (real_input && conf.IsAliasingNegativeFrequencies()) {
+            /* terms with a counterpart (all but DC and, for even widths, Nyquist) are doubled, i.e. +6dB */
+            static const double alias_gain = 20.0 * std::log10(2.0);
+            std::size_t last = (conf.GetFFTWidth() % 2 == 0) ? fft_values.size() - 1 : fft_values.size();
+            decibel_map->MapPower(fft_values.first(1), 0.0, normalized.first(1));
+            decibel_map->MapPower(fft_values.subspan(1, last - 1), alias_gain, normalized.subspan(1, last - 1));
+            decibel_map->MapPower(fft_values.subspan(last), 0.0, normalized.subspan(last));
+        } else {
+            decibel_map->MapPower(fft_values, 0.0, normalized);
+        }
+    } else {
+        /* compute magnitude */
+        if (real_input) {
+            BasicFFT<P>::GetHalfSpectrumMagnitude(fft_values, conf.GetFFTWidth(),
+                                                  conf.IsAliasingNegativeFrequencies(), ws.magnitude);
+        } else {
+            BasicFFT<P>::GetMagnitude(fft_values, conf.IsAliasingNegativeFrequencies(), ws.magnitude);
+        }
 
-    /* from now on we have a leakable resource (the file); if using STDIN for input, we're here from a SIGINT,
-     * and we expect a SIGPIPE soon; install a handler that will clean up */
-    std::signal(SIGPIPE, [](int) { std::remove(temp_file_name.c_str()); /* no logger, no checks */ std::exit(0); });
+        /* map magnitude to [0..1] domain */
+        value_map.Map(ws.magnitude, ws.normalized);
+    }
+    std::span<const P> normalized_magnitude = ws.normalized;
+    if (real_input) {
+        /* mapping was done on the non-negative half only; mirror to full spectrum */
+        BasicFFT<P>::MirrorHalfSpectrum(ws.normalized, conf.GetFFTWidth(), ws.mirrored);
+        normalized_magnitude = ws.mirrored;
+    }
 
-    /* dump */
-    std::ifstream file(temp_file_name, std::ios::in | std::ios::binary);
-    if (file.fail()) {
-        throw std::runtime_error("cannot read temp file " + temp_file_name);
+    if (conf.CanResample()) {
+        /* resample to display width */
+        ws.resample_plan->Apply(normalized_magnitude, ws.display);
+    } else {
+        /* crop to display width */
+        BasicFFT<P>::Crop(normalized_magnitude, conf.GetRate(), conf.GetMinFreq(), conf.GetMaxFreq(), ws.display);
+    }
+    if (conf.MustPrintOutput()) {
+        print_real_window<P>("output", ws.display);
     }
-    while (!file.eof()) {
-        char buffer[TEMP_BUFFER_SIZE];
-        file.read(buffer, TEMP_BUFFER_SIZE);
-        std::size_t read_count = file.gcount();
-        std::cout.write(buffer, read_count);
+
+    /* previous average was complete (and consumed); reset */
+    assert(conf.GetAverageCount() > 0);
+    if (ws.window_sum_count == conf.GetAverageCount()) {
+        ws.window_sum_count = 0;
+        std::fill(ws.window_sum.begin(), ws.window_sum.end(), 0.0);
     }
-    file.close();
 
-    /* clean up */
-    if (std::remove(temp_file_name.c_str()) != 0) {
-        WARN("Failed to delete temp file " << temp_file_name);
+    /* add to running total */
+    assert(ws.window_sum.size() == ws.display.size());
+    for (std::size_t i = 0; i < ws.window_sum.size(); i++) {
+        ws.window_sum[i] += ws.display[i] / (double)conf.GetAverageCount();
     }
+    ws.window_sum_count++;
+
+    return ws.window_sum_count == conf.GetAverageCount();
 }
 
 /*
- * entry point
+ * number of FFT windows computed by the main loop over block_count blocks: a window is taken (and the stride
+ * removed) after a block is parsed, if enough values are buffered for both a window and the stride
  */
-int
-main(int argc, char** argv)
+std::size_t
+count_windows(std::size_t block_count, std::size_t block_size, std::size_t fft_width, std::size_t fft_stride)
 {
-    /* parse command line arguments into global settings */
-    auto [conf, conf_rc, conf_must_exit] = Configuration::Build(argc, (const char **)argv);
-    if (conf_must_exit) {
-        return conf_rc;
+    std::size_t buffered = 0;
+    std::size_t windows = 0;
+    for (std::size_t i = 0; i < block_count; i++) {
+        buffered += block_size;
+        if (buffered >= std::max(fft_width, fft_stride)) {
+            buffered -= fft_stride;
+            windows++;
+        }
+    }
+    return windows;
+}
+
+/*
+ * compute the displayed rows for a contiguous range of FFT windows of an input file. Window i starts at value
+ * i * fft_stride; the rows are the same as the main loop would produce for these windows, provided first_window is
+ * a multiple of the average count.
+ */
+template <class P>
+History
+render_chunk(const Configuration& conf, std::span<const char> data, std::size_t first_window,
+             std::size_t window_count, BasicFFT<P>& fft, BasicValueMap<P>& value_map)
+{
+    History rows(conf.GetWidth());
+    if (window_count == 0) {
+        return rows;
+    }
+
+    auto input = BasicInputParser<P>::Build(conf.GetDataType(), conf.GetPrescaleFactor(), conf.HasComplexInput());
+    assert(input != nullptr);
+
+    /* byte range of the chunk, fed to the parser one block at a time */
+    auto value_size = input->GetDataTypeSize();
+    auto block_bytes = conf.GetBlockSize() * value_size;
+    auto offset = first_window * conf.GetFFTStride() * value_size;
+    auto end = ((first_window + window_count - 1) * conf.GetFFTStride() + conf.GetFFTWidth()) * value_size;
+    assert(end <= data.size());
+    auto parse_until = [&](std::size_t count) {
+        while (input->GetBufferedValueCount() < count) {
+            assert(offset < end);
+            auto size = std::min(block_bytes, end - offset);
+            input->ParseBlock(data.subspan(offset, size));
+            offset += size;
+        }
+    };
+
+    Workspace<P> ws(conf, fft);
+    auto process_fft_windows = [&](std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+            if (accumulate_fft_window(conf, value_map, ws.GetFFTWindow(fft, i), ws)) {
+                rows.AddRow(ws.window_sum);
+            }
+        }
+    };
+
+    for (std::size_t i = 0; (i < window_count) && main_loop_running; i++) {
+        /* retrieve window as a view into the parser's buffer */
+        parse_until(conf.GetFFTWidth());
+        auto window_values = input->PeekValues(conf.GetFFTWidth());
+
+        /* transform (possibly in batches), then move on to the next window */
+        if (fft.GetBatchSize() > 1) {
+            fft.Stage(window_values);
+            if (fft.GetStagedCount() == fft.GetBatchSize()) {
+                process_fft_windows(fft.ComputeBatch(ws.fft_values));
+            }
+        } else {
+            fft.Compute(window_values, std::span(ws.fft_values).first(fft.GetOutputWidth()));
+            process_fft_windows(1);
+        }
+        if (i + 1 < window_count) {
+            parse_until(conf.GetFFTStride());
+            input->RemoveValues(conf.GetFFTStride());
+        }
+    }
+
+    /* process windows left in an incomplete batch */
+    process_fft_windows(fft.ComputeBatch(ws.fft_values));
+
+    return rows;
+}
+
+/*
+ * compute the displayed rows of an input file on a pool of threads, one processing object set (FFT plan and value
+ * map) per thread. Rows are computed in chunks of consecutive rows and handed to consume() in order, one chunk at a
+ * time; only a few chunks are kept in flight, so memory use does not depend on the input length. If processing is
+ * interrupted, the rows after the first truncated chunk are discarded, so no time gaps appear in the output.
+ */
+template <class P>
+void
+process_chunks(const Configuration& conf, std::span<const char> data, std::size_t row_count,
+               std::vector<std::reference_wrapper<BasicFFT<P>>>& ffts,
+               std::vector<std::reference_wrapper<BasicValueMap<P>>>& value_maps,
+               const std::function<void(const History&)>& consume)
+{
+    static constexpr std::size_t CHUNK_ROWS = 512;
+    const std::size_t chunk_count = (row_count + CHUNK_ROWS - 1) / CHUNK_ROWS;
+    const std::size_t max_in_flight = 2 * ffts.size();
+
+    auto chunk_rows = [&](std::size_t c) { return std::min(CHUNK_ROWS, row_count - c * CHUNK_ROWS); };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::optional<History>> chunks(chunk_count);
+    std::size_t next_chunk = 0;     /* first chunk not yet handed to a worker */
+    std::size_t consumed = 0;       /* number of chunks taken out for consumption */
+    bool stopped = false;           /* no more chunks are handed out */
+    std::exception_ptr error = nullptr;
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < ffts.size(); t++) {
+        workers.emplace_back([&, t]() {
+            for (;;) {
+                std::size_t c;
+                {
+                    std::unique_lock lock(mutex);
+                    changed.wait(lock, [&]() {
+                        return stopped || (next_chunk == chunk_count) || (next_chunk < consumed + max_in_flight);
+                    });
+                    if (stopped || (next_chunk == chunk_count)) {
+                        return;
+                    }
+                    c = next_chunk++;
+                }
+
+                /* chunks overlap by fft_width - fft_stride values, which are parsed twice */
+                std::optional<History> rows;
+                std::exception_ptr chunk_error = nullptr;
+                try {
+                    rows = render_chunk(conf, data, c * CHUNK_ROWS * conf.GetAverageCount(),
+                                        chunk_rows(c) * conf.GetAverageCount(), ffts[t].get(), value_maps[t].get());
+                } catch (...) {
+                    chunk_error = std::current_exception();
+                }
+
+                {
+                    std::lock_guard lock(mutex);
+                    if (chunk_error) {
+                        error = chunk_error;
+                        stopped = true;
+                    } else {
+                        chunks[c] = std::move(rows);
+                    }
+                }
+                changed.notify_all();
+            }
+        });
+    }
+
+    /* stitch chunks in order, releasing each once consumed */
+    for (std::size_t c = 0; c < chunk_count; c++) {
+        std::optional<History> rows;
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(lock, [&]() { return chunks[c].has_value() || (error != nullptr); });
+            if (error) {
+                break;
+            }
+            rows.swap(chunks[c]);
+            consumed = c + 1;
+        }
+        changed.notify_all();
+
+        consume(*rows);
+        if (rows->GetRowCount() < chunk_rows(c)) {
+            /* interrupted */
+            break;
+        }
     }
 
+    {
+        std::lock_guard lock(mutex);
+        stopped = true;
+    }
+    changed.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+/*
+ * spectrogram generation, with signal processing done in precision P
+ */
+template <class P>
+int
+run(const Configuration& conf)
+{
     /* decide whether we have output or not */
     bool have_output = conf.GetOutputFilename().has_value() || conf.MustDumpToStdout();
 
     /* create window function */
-    auto win_function = WindowFunction::Build(conf.GetWindowFunction(), conf.GetFFTWidth());
+    auto win_function = BasicWindowFunction<P>::Build(conf.GetWindowFunction(), conf.GetFFTWidth());
+
+    /* with a rigorous planner, reuse wisdom from previous runs so that planning is (mostly) instant */
+    bool use_wisdom = (conf.GetFFTPlanner() != FFTPlanner::kEstimate);
+    auto wisdom_filename = get_wisdom_filename<P>();
+    if (use_wisdom && !wisdom_filename.empty() && std::filesystem::exists(wisdom_filename)) {
+        if (BasicFFT<P>::ImportWisdom(wisdom_filename)) {
+            INFO("Imported FFTW wisdom from " << wisdom_filename.string());
+        } else {
+            WARN("Failed to import FFTW wisdom from " << wisdom_filename.string());
+        }
+    }
 
-    /* create FFT */
-    INFO("Creating " << conf.GetFFTWidth() << "-wide FFTW plan");
-    FFT fft(conf.GetFFTWidth(), win_function);
+    /* when rendering a file offline, windows are transformed in batches; keep a batch's input buffer within a few
+     * MiB so it stays in cache. Batching is disabled when input windows are printed, to keep the debug output of
+     * each window together. */
+    static constexpr std::size_t FFT_BATCH_BYTES = 4 * 1024 * 1024;
+    static constexpr std::size_t FFT_MAX_BATCH_SIZE = 64;
+    std::size_t fft_batch_size = 1;
+    if (conf.GetInputFilename().has_value() && !conf.IsLive() && !conf.MustPrintInput()) {
+        fft_batch_size = std::clamp<std::size_t>(FFT_BATCH_BYTES / (conf.GetFFTWidth() * sizeof(std::complex<P>)),
+                                                 1, FFT_MAX_BATCH_SIZE);
+    }
+
+    /* create FFT; for real input, only the non-negative half of the spectrum is needed */
+    INFO("Creating " << conf.GetFFTWidth() << "-wide FFTW plan" <<
+         (fft_batch_size > 1 ? " (batches of " + std::to_string(fft_batch_size) + " windows)" : ""));
+    BasicFFT<P> fft(conf.GetFFTWidth(), win_function, !conf.HasComplexInput(), conf.GetFFTPlanner(), fft_batch_size);
+
+    /* store whatever the planner learned for next time */
+    if (use_wisdom && !wisdom_filename.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(wisdom_filename.parent_path(), ec);
+        if (ec || !BasicFFT<P>::ExportWisdom(wisdom_filename)) {
+            WARN("Failed to export FFTW wisdom to " << wisdom_filename.string());
+        }
+    }
 
     /* create value map */
     INFO("Scale " << (conf.GetScaleType() == ValueMapType::kLinear ? "linear" : "decibel") <<
          ", unit " << conf.GetScaleUnit() << ", bounds [" << conf.GetScaleLowerBound() <<
          ", " << conf.GetScaleUpperBound() << "]");
-    std::unique_ptr<ValueMap> value_map = ValueMap::Build(conf.GetScaleType(),
-                                                          conf.GetScaleLowerBound(),
-                                                          conf.GetScaleUpperBound(),
-                                                          conf.GetScaleUnit());
+    std::unique_ptr<BasicValueMap<P>> value_map = BasicValueMap<P>::Build(conf.GetScaleType(),
+                                                                          conf.GetScaleLowerBound(),
+                                                                          conf.GetScaleUpperBound(),
+                                                                          conf.GetScaleUnit());
 
-    /* create color map */
-    auto color_map = ColorMap::Build(conf.GetColorMap(), conf.GetBackgroundColor(),
-                                     conf.GetColorMapCustomColor());
-
-    /* create live window */
+    /* create live window, fed with displayed windows by the processing thread */
     std::unique_ptr<LiveOutput> live = nullptr;
+    std::unique_ptr<SlotQueue<double>> live_rows = nullptr;
     if (conf.IsLive()) {
         live = std::make_unique<LiveOutput>(conf);
         live->Render(); /* render empty window */
+        live_rows = std::make_unique<SlotQueue<double>>(conf.GetWidth(), conf.GetCount());
     }
 
     /* create input parser */
-    auto input = InputParser::Build(conf.GetDataType(), conf.GetPrescaleFactor(), conf.HasComplexInput());
+    auto input = BasicInputParser<P>::Build(conf.GetDataType(), conf.GetPrescaleFactor(), conf.HasComplexInput());
     if (input == nullptr) {
         return 1;
     }
@@ -186,19 +557,27 @@ main(int argc, char** argv)
     std::unique_ptr<InputReader> reader = nullptr;
     if (conf.GetInputFilename().has_value()) {
         INFO("Input: " << *conf.GetInputFilename());
-        input_stream = new std::ifstream(*conf.GetInputFilename(), std::ios::in | std::ios::binary);
-        assert(input_stream != nullptr);
-        if (!input_stream->good()) {
-            ERROR("Failed to open input file " << *conf.GetInputFilename());
-            return 1;
+        try {
+            reader = std::make_unique<MmapInputReader>(*conf.GetInputFilename(),
+                                                       input->GetDataTypeSize() * conf.GetBlockSize());
+        } catch (const std::runtime_error& e) {
+            /* not mappable (e.g. named pipe); fall back to reading through a stream */
+            WARN("Cannot memory map input (" << e.what() << "), reading synchronously");
+            input_stream = new std::ifstream(*conf.GetInputFilename(), std::ios::in | std::ios::binary);
+            assert(input_stream != nullptr);
+            if (!input_stream->good()) {
+                ERROR("Failed to open input file " << *conf.GetInputFilename());
+                return 1;
+            }
+            reader = std::make_unique<SyncInputReader>(input_stream,
+                                                       input->GetDataTypeSize() * conf.GetBlockSize());
         }
-        reader = std::make_unique<SyncInputReader>(input_stream,
-                                                   input->GetDataTypeSize() * conf.GetBlockSize());
     } else {
         INFO("Input: STDIN");
         input_stream = &std::cin;
         reader = std::make_unique<AsyncInputReader>(input_stream,
-                                                    input->GetDataTypeSize() * conf.GetBlockSize());
+                                                    input->GetDataTypeSize() * conf.GetBlockSize(),
+                                                    conf.GetQueueDepth());
     }
 
     /* display initialization info */
@@ -214,159 +593,273 @@ main(int argc, char** argv)
     /* install SIGINT handler for CTRL+C */
     std::signal(SIGINT, sigint_handler);
 
-    /* FFT window history */
-    std::list<std::vector<uint8_t>> history;
+    /* the number of windows in a regular input file is known up front, so vertical PNG output can be rendered and
+     * written strip by strip as windows are computed, and memory use does not depend on the input length; in any
+     * other case displayed windows are kept in memory and rendered at the end */
+    auto mmap_reader = dynamic_cast<const MmapInputReader *>(reader.get());
+    std::size_t window_count = 0;
+    if (mmap_reader != nullptr) {
+        window_count = count_windows(mmap_reader->GetBlockCount(), conf.GetBlockSize(), conf.GetFFTWidth(),
+                                     conf.GetFFTStride());
+    }
+    std::size_t row_count = window_count / conf.GetAverageCount();
+
+    std::unique_ptr<Renderer> stream_renderer = nullptr;
+    std::unique_ptr<std::ofstream> output_file = nullptr;
+    std::unique_ptr<PngWriter> png = nullptr;
+    std::unique_ptr<StripStream> strips = nullptr;
+    if (have_output && (row_count > 0) && !conf.IsHorizontal()
+        && (!conf.GetOutputFilename().has_value() || is_png_filename(*conf.GetOutputFilename()))) {
+        std::ostream *output_stream = &std::cout;
+        if (conf.GetOutputFilename().has_value()) {
+            INFO("Output: " << *conf.GetOutputFilename() << ", written while processing");
+            output_file = std::make_unique<std::ofstream>(*conf.GetOutputFilename(),
+                                                          std::ios::out | std::ios::binary);
+            if (output_file->fail()) {
+                throw std::runtime_error("cannot open output file " + *conf.GetOutputFilename());
+            }
+            output_stream = output_file.get();
+        } else {
+            INFO("Output: STDOUT, written while processing");
+            /* the reader at the other end of the pipe may be gone; exit quietly when it is */
+            std::signal(SIGPIPE, [](int) { /* no logger, no checks */ std::_Exit(0); });
+        }
 
-    /* window average */
-    RealWindow window_sum;
-    window_sum.resize(conf.GetWidth());
-    std::size_t window_sum_count = 0;
+        stream_renderer = std::make_unique<Renderer>(conf, row_count);
+        png = std::make_unique<PngWriter>(*output_stream, stream_renderer->GetOutputWidth(),
+                                          stream_renderer->GetOutputHeight(), conf.GetPNGCompression());
+        strips = std::make_unique<StripStream>(*stream_renderer, [&png](std::span<const uint8_t> rows) {
+            png->WriteRows(rows);
+        });
+    }
 
-    /* main loop */
-    while (main_loop_running && !reader->ReachedEOF()) {
-        /* check for window events (if necessary) and redraw */
-        if (live != nullptr) {
-            if (!live->HandleEvents()) {
-                /* exited by closing window */
-                main_loop_running = false;
-                /* uninstall signal so that reader thread can exit successfully */
-                std::signal(SIGINT, nullptr);
+    /* displayed window history, when not streaming */
+    History history(conf.GetWidth());
+
+    /* buffers for all processing stages */
+    Workspace<P> ws(conf, fft);
+
+    /* turns the output of the FFT into displayed windows (possibly after averaging) */
+    auto process_fft_windows = [&](std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+            if (!accumulate_fft_window(conf, *value_map, ws.GetFFTWindow(fft, i), ws)) {
+                /* we still have to compute some more windows before we show */
+                continue;
             }
-            live->Render();
-        }
 
-        /* check for a complete block */
-        auto block = reader->GetBlock();
-        if (!block) {
-            /* block not finished yet */
-            if (auto sleep = conf.GetSleepForInput()) {
-                /* sleep for a bit so we don't busywait on sparse input */
-                std::this_thread::sleep_for(std::chrono::duration<size_t, std::milli>(sleep));
+            /* hand over to live window; if it fell a whole screen behind, the window is dropped */
+            if (live_rows != nullptr) {
+                if (auto slot = live_rows->AcquireWrite()) {
+                    std::copy(ws.window_sum.begin(), ws.window_sum.end(), slot->begin());
+                    live_rows->Push();
+                }
+            }
+            if (strips != nullptr) {
+                strips->AddRow(ws.window_sum);
+            } else if (have_output) {
+                history.AddRow(ws.window_sum);
             }
-            continue;
         }
+    };
+
+    /* offline rendering of a mapped file can be split across threads */
+    bool processed_in_chunks = false;
+    if (conf.GetThreadCount() > 1) {
+        if (mmap_reader == nullptr || live != nullptr || !have_output
+            || conf.MustPrintInput() || conf.MustPrintFFT() || conf.MustPrintOutput()) {
+            WARN("Multiple threads are only used when rendering a regular input file to an output file, "
+                 "without printing; using one thread");
+        } else {
+            /* same windows as the single threaded loop below would compute, grouped into displayed rows */
+            auto thread_count = std::max<std::size_t>(1, std::min(conf.GetThreadCount(), row_count));
+            INFO("Processing " << window_count << " windows on " << thread_count << " threads");
+
+            /* each worker has its own processing objects; the first one reuses ours. Plans are created here, since
+             * FFTW planning is not thread safe */
+            std::vector<std::unique_ptr<BasicFFT<P>>> worker_ffts;
+            std::vector<std::unique_ptr<BasicValueMap<P>>> worker_value_maps;
+            std::vector<std::reference_wrapper<BasicFFT<P>>> ffts { fft };
+            std::vector<std::reference_wrapper<BasicValueMap<P>>> value_maps { *value_map };
+            for (std::size_t t = 1; t < thread_count; t++) {
+                auto worker_win_function = BasicWindowFunction<P>::Build(conf.GetWindowFunction(),
+                                                                         conf.GetFFTWidth());
+                worker_ffts.push_back(std::make_unique<BasicFFT<P>>(conf.GetFFTWidth(), worker_win_function,
+                                                                    !conf.HasComplexInput(), conf.GetFFTPlanner(),
+                                                                    fft_batch_size));
+                worker_value_maps.push_back(BasicValueMap<P>::Build(conf.GetScaleType(), conf.GetScaleLowerBound(),
+                                                                    conf.GetScaleUpperBound(),
+                                                                    conf.GetScaleUnit()));
+                ffts.push_back(*worker_ffts.back());
+                value_maps.push_back(*worker_value_maps.back());
+            }
 
-        /* take whatever is available from input stream */
-        auto pvc = input->ParseBlock(*block);
-        assert(pvc == block->size() / input->GetDataTypeSize());
-
-        /* check if we have enough for a new FFT window */
-        if ((input->GetBufferedValueCount() < conf.GetFFTWidth())
-            || (input->GetBufferedValueCount() < conf.GetFFTStride())) {
-            /* wait until we get enough values for a window and the spacing between windows */
-            continue;
+            process_chunks<P>(conf, mmap_reader->GetData(), row_count, ffts, value_maps,
+                              [&](const History& rows) {
+                                  if (strips != nullptr) {
+                                      strips->Append(rows);
+                                  } else {
+                                      history.Append(rows);
+                                  }
+                              });
+            processed_in_chunks = true;
         }
+    }
 
-        /* retrieve window and remove values that won't be used further */
-        auto window_values = input->PeekValues(conf.GetFFTWidth());
-        input->RemoveValues(conf.GetFFTStride());
-        if (conf.MustPrintInput()) {
-            print_complex_window("input", window_values);
-        }
+    /* main loop: read input, compute and process windows */
+    auto process_input = [&]() {
+        while (!processed_in_chunks && main_loop_running && !reader->ReachedEOF()) {
+            /* check for a complete block */
+            auto block = reader->GetBlock();
+            if (!block) {
+                /* block not finished yet */
+                if (auto sleep = conf.GetSleepForInput()) {
+                    /* sleep for a bit so we don't busywait on sparse input */
+                    std::this_thread::sleep_for(std::chrono::duration<size_t, std::milli>(sleep));
+                }
+                continue;
+            }
 
-        /* compute FFT on fetched window */
-        auto fft_values = fft.Compute(window_values);
-        if (conf.MustPrintFFT()) {
-            print_complex_window("fft", fft_values);
-        }
+            /* take whatever is available from input stream */
+            auto pvc = input->ParseBlock(*block);
+            assert(pvc == block->size() / input->GetDataTypeSize());
 
-        /* compute magnitude */
-        auto fft_magnitude = FFT::GetMagnitude(fft_values, conf.IsAliasingNegativeFrequencies());
+            /* check if we have enough for a new FFT window */
+            if ((input->GetBufferedValueCount() < conf.GetFFTWidth())
+                || (input->GetBufferedValueCount() < conf.GetFFTStride())) {
+                /* wait until we get enough values for a window and the spacing between windows */
+                continue;
+            }
 
-        /* map magnitude to [0..1] domain */
-        auto normalized_magnitude = value_map->Map(fft_magnitude);
+            /* retrieve window as a view into the parser's buffer */
+            auto window_values = input->PeekValues(conf.GetFFTWidth());
+            if (conf.MustPrintInput()) {
+                print_complex_window("input", window_values);
+            }
 
-        if (conf.CanResample()) {
-            /* resample to display width */
-            normalized_magnitude = FFT::Resample(normalized_magnitude, conf.GetRate(), conf.GetWidth(),
-                                                 conf.GetMinFreq(), conf.GetMaxFreq());
-        } else {
-            /* crop to display width */
-            normalized_magnitude = FFT::Crop(normalized_magnitude, conf.GetRate(),
-                                             conf.GetMinFreq(), conf.GetMaxFreq());
-        }
-        if (conf.MustPrintOutput()) {
-            print_real_window("output", normalized_magnitude);
-        }
+            if (fft.GetBatchSize() > 1) {
+                /* stage a copy of the window, then remove values that won't be used further */
+                fft.Stage(window_values);
+                input->RemoveValues(conf.GetFFTStride());
 
-        /* add to running total */
-        assert(window_sum.size() == normalized_magnitude.size());
-        assert(conf.GetAverageCount() > 0);
-        for (std::size_t i = 0; i < window_sum.size(); i++) {
-            window_sum[i] += normalized_magnitude[i] / (double)conf.GetAverageCount();
+                /* transform and process the whole batch once it is complete */
+                if (fft.GetStagedCount() == fft.GetBatchSize()) {
+                    process_fft_windows(fft.ComputeBatch(ws.fft_values));
+                }
+            } else {
+                /* compute FFT on fetched window, then remove values that won't be used further */
+                fft.Compute(window_values, std::span(ws.fft_values).first(fft.GetOutputWidth()));
+                input->RemoveValues(conf.GetFFTStride());
+                process_fft_windows(1);
+            }
         }
-        window_sum_count++;
 
-        if (window_sum_count < conf.GetAverageCount()) {
-            /* we still have to compute some more windows before we show */
-            continue;
-        }
+        /* process windows left in an incomplete batch */
+        process_fft_windows(fft.ComputeBatch(ws.fft_values));
+    };
+
+    if (live != nullptr) {
+        /* process input on a separate thread, so this one is free to present the live window */
+        std::atomic<bool> processing_done = false;
+        std::exception_ptr processing_error = nullptr;
+        std::thread processor([&]() {
+            try {
+                process_input();
+            } catch (...) {
+                processing_error = std::current_exception();
+            }
+            processing_done = true;
+        });
+
+        /* present frames at a fixed rate, each adding all windows processed since the previous one */
+        const auto frame_period = std::chrono::nanoseconds(std::chrono::seconds(1)) / conf.GetFrameRate();
+        auto next_frame = std::chrono::steady_clock::now();
+        for (;;) {
+            /* sampled before draining, so no window is left behind when done */
+            bool done = processing_done;
 
-        /* add to live */
-        if (live != nullptr) {
-            auto colorized = live->AddWindow(window_sum);
-            if (have_output) {
-                history.push_back(colorized);
+            if (!live->HandleEvents() && main_loop_running) {
+                /* exited by closing window */
+                main_loop_running = false;
+                /* uninstall signal so that reader thread can exit successfully */
+                std::signal(SIGINT, nullptr);
+            }
+
+            while (auto row = live_rows->Front()) {
+                live->AddWindow(*row);
+                live_rows->Pop();
+            }
+            live->Render();
+
+            if (done) {
+                break;
+            }
+
+            /* if falling behind, skip frames instead of rushing to catch up */
+            next_frame += frame_period;
+            auto now = std::chrono::steady_clock::now();
+            if (next_frame < now) {
+                next_frame = now;
+            } else {
+                std::this_thread::sleep_until(next_frame);
             }
-        } else if (have_output) {
-            history.push_back(color_map->Map(window_sum));
         }
 
-        /* reset */
-        window_sum_count = 0;
-        for (auto& v : window_sum) {
-            v = 0.0f;
+        processor.join();
+        if (processing_error) {
+            std::rethrow_exception(processing_error);
         }
+    } else {
+        process_input();
     }
     INFO("Terminating ...");
 
+    /* report live queue usage */
+    if (live_rows != nullptr) {
+        INFO("Live queue: high-water mark " << live_rows->GetHighWaterMark() << "/" << live_rows->GetDepth() <<
+             " windows, " << live_rows->GetOverrunCount() << " overruns");
+        if (live_rows->GetOverrunCount() > 0) {
+            WARN("Live window could not keep up with input; " << live_rows->GetOverrunCount() <<
+                 " windows were not displayed");
+        }
+    }
+
+    /* report input queue usage */
+    if (auto async_reader = dynamic_cast<const AsyncInputReader *>(reader.get())) {
+        INFO("Input queue: high-water mark " << async_reader->GetHighWaterMark() << "/" <<
+             async_reader->GetQueueDepth() << " blocks, " << async_reader->GetOverrunCount() << " overruns");
+        if (async_reader->GetOverrunCount() > 0) {
+            WARN("Input was throttled; consider increasing the queue depth (--queue_depth)");
+        }
+    }
+
     /* close input file */
-    if (conf.GetInputFilename().has_value()) {
-        assert(input_stream != nullptr);
+    if (conf.GetInputFilename().has_value() && (input_stream != nullptr)) {
         assert(input_stream != &std::cin);
         delete input_stream;
         input_stream = nullptr;
     }
 
-    /* save file */
-    if (have_output) {
-        Renderer file_renderer(conf, history.size());
-        file_renderer.RenderFFTArea(history);
-        auto image = file_renderer.GetCanvas().copyToImage();
-
-        /* rotate, if needed */
-        if (conf.IsHorizontal()) {
-            std::size_t w = image.getSize().x;
-            std::size_t h = image.getSize().y;
-
-            /* allocate memory */
-            auto iptr = reinterpret_cast<const uint32_t *>(image.getPixelsPtr());
-            uint32_t *optr = new uint32_t[w * h];
-
-            /* copy 4 bytes (one pixel) at a time */
-            for (std::size_t l = 0; l < h; l ++) {
-                auto in = iptr + l * w;
-                auto out = optr + (w-1) * h + l;
-                for (std::size_t c = 0; c < w; c++, in++, out -= h) {
-                    *out = *in;
-                }
-            }
-
-            /* create rotated image */
-            sf::Image rimage;
-            rimage.create(h, w, reinterpret_cast<const uint8_t *>(optr));
-            delete[] optr;
-
-            image = rimage;
+    /* finish streamed output; its height was fixed up front, so windows not computed are left blank */
+    if (strips != nullptr) {
+        if (strips->GetRowCount() < row_count) {
+            WARN("Interrupted; the last " << (row_count - strips->GetRowCount()) << " of " << row_count <<
+                 " windows are left blank in the output");
         }
+        strips->Finish();
+        png->Finish();
+    }
+
+    /* save file */
+    if (have_output && (strips == nullptr)) {
+        Renderer file_renderer(conf, history.GetRowCount());
 
         /* dump to file or stdout */
         if (conf.GetOutputFilename().has_value()) {
             INFO("Output: " << *conf.GetOutputFilename());
-            image.saveToFile(*conf.GetOutputFilename());
+            save_image(file_renderer, history, *conf.GetOutputFilename(), conf.GetPNGCompression());
         } else if (conf.MustDumpToStdout()) {
             INFO("Output: STDOUT");
-            dump_to_stdout(image);
+            dump_to_stdout(file_renderer, history, conf.GetPNGCompression());
         } else {
             throw std::runtime_error("don't know what to do with output");
         }
@@ -375,3 +868,25 @@ main(int argc, char** argv)
     /* all ok */
     return 0;
 }
+
+/*
+ * entry point
+ */
+int
+main(int argc, char** argv)
+{
+    /* parse command line arguments into global settings */
+    auto [conf, conf_rc, conf_must_exit] = Configuration::Build(argc, (const char **)argv);
+    if (conf_must_exit) {
+        return conf_rc;
+    }
+
+    /* run the signal processing pipeline in the requested precision */
+    if (conf.GetPrecision() == Precision::kSingle) {
+        INFO("Precision: single");
+        return run<float>(conf);
+    } else {
+        INFO("Precision: double");
+        return run<double>(conf);
+    }
+}
@@ -5,10 +5,13 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 #include "value-map.hpp"
+#include "decibel-conversion.hpp"
 #include <algorithm>
 #include <cmath>
 
-ValueMap::ValueMap(double lower, double upper, const std::string& unit) : lower_(lower), upper_(upper), unit_(unit)
+template <class P>
+BasicValueMap<P>::BasicValueMap(double lower, double upper, const std::string& unit)
+    : lower_(lower), upper_(upper), unit_(unit)
 {
     if (std::isnan(lower) || std::isnan(upper) || std::isinf(lower) || std::isinf(upper)) {
         throw std::runtime_error("bounds cannot be nan or inf");
@@ -18,65 +21,92 @@ ValueMap::ValueMap(double lower, double upper, const std::string& unit) : lower_
     }
 }
 
+template <class P>
 std::string
-ValueMap::GetUnit() const
+BasicValueMap<P>::GetUnit() const
 {
     return unit_;
 }
 
-std::unique_ptr<ValueMap>
-ValueMap::Build(ValueMapType type, double lower, double upper, std::string unit)
+template <class P>
+BasicRealWindow<P>
+BasicValueMap<P>::Map(const BasicRealWindow<P>& input)
+{
+    BasicRealWindow<P> output(input.size());
+    this->Map(input, output);
+    return output;
+}
+
+template <class P>
+std::unique_ptr<BasicValueMap<P>>
+BasicValueMap<P>::Build(ValueMapType type, double lower, double upper, std::string unit)
 {
     switch (type) {
         case ValueMapType::kLinear:
-            return std::make_unique<LinearValueMap>(lower, upper, unit);
+            return std::make_unique<LinearValueMap<P>>(lower, upper, unit);
 
         case ValueMapType::kDecibel:
-            return std::make_unique<DecibelValueMap>(lower, upper, unit);
+            return std::make_unique<DecibelValueMap<P>>(lower, upper, unit);
 
         default:
             throw std::runtime_error("unknown value map type");
     }
 }
 
-LinearValueMap::LinearValueMap(double lower, double upper, const std::string &unit)
-    : ValueMap(lower, upper, unit)
+template <class P>
+LinearValueMap<P>::LinearValueMap(double lower, double upper, const std::string &unit)
+    : BasicValueMap<P>(lower, upper, unit)
 {
 }
 
-RealWindow LinearValueMap::Map(const RealWindow &input)
+template <class P>
+void LinearValueMap<P>::Map(std::span<const P> input, std::span<P> output)
 {
     auto n = input.size();
-    RealWindow output(n);
+    if (output.size() != n) {
+        throw std::runtime_error("output window size must match input size");
+    }
 
     for (unsigned int i = 0; i < n; i ++) {
-        output[i] = std::clamp<double>(input[i], this->lower_, this->upper_);
-        output[i] = (output[i] - this->lower_) / (this->upper_ - this->lower_);
+        double value = std::clamp<double>(input[i], this->lower_, this->upper_);
+        output[i] = static_cast<P>((value - this->lower_) / (this->upper_ - this->lower_));
     }
-
-    return output;
 }
 
-DecibelValueMap::DecibelValueMap(double lower, double upper, const std::string &unit)
-    : ValueMap(lower, upper, unit)
+template <class P>
+DecibelValueMap<P>::DecibelValueMap(double lower, double upper, const std::string &unit)
+    : BasicValueMap<P>(lower, upper, unit)
 {
 }
 
-RealWindow DecibelValueMap::Map(const RealWindow &input)
+template <class P>
+void DecibelValueMap<P>::Map(std::span<const P> input, std::span<P> output)
 {
     auto n = input.size();
-    RealWindow output(n);
+    if (output.size() != n) {
+        throw std::runtime_error("output window size must match input size");
+    }
 
     for (unsigned int i = 0; i < n; i ++) {
-        output[i] = 20.0 * std::log10(input[i]);
-        output[i] = std::clamp<double>(output[i], this->lower_, this->upper_);
-        output[i] = (output[i] - this->lower_) / (this->upper_ - this->lower_);
+        P value = 20 * std::log10(input[i]);
+        value = std::clamp<P>(value, this->lower_, this->upper_);
+        output[i] = (value - this->lower_) / (this->upper_ - this->lower_);
     }
+}
 
-    return output;
+template <class P>
+void DecibelValueMap<P>::MapPower(std::span<const std::complex<P>> input, double gain, std::span<P> output) const
+{
+    MapPowerToDecibels<P>(input, gain, this->lower_, this->upper_, output);
 }
 
-std::string DecibelValueMap::GetUnit() const
+template <class P>
+std::string DecibelValueMap<P>::GetUnit() const
 {
-    return "dB" + unit_;
+    return "dB" + this->unit_;
 }
+
+template class BasicValueMap<float>;
+template class BasicValueMap<double>;
+template class DecibelValueMap<float>;
+template class DecibelValueMap<double>;
@@ -24,8 +24,10 @@ enum class ValueMapType {
 
 /**
  * Base value map class
+ * @tparam P Precision of mapped values (float or double).
  */
-class ValueMap {
+template <class P>
+class BasicValueMap {
 protected:
     const double lower_;        /* lower bound, in whatever unit */
     const double upper_;        /* upper bound, in whatever unit */
@@ -36,10 +38,11 @@ protected:
      * @param upper Upper bound of scale.
      * @param unit Unit.
      */
-    ValueMap(double lower_, double upper, const std::string& unit);
+    BasicValueMap(double lower_, double upper, const std::string& unit);
 
 public:
-    ValueMap() = delete;
+    BasicValueMap() = delete;
+    virtual ~BasicValueMap() = default;
 
     auto GetLowerBound() const { return lower_; }
     auto GetUpperBound() const { return upper_; }
@@ -50,7 +53,16 @@ public:
      * @param input Input values in whatever unit.
      * @return Output corresponding values, in the [0..1] domain.
      */
-    virtual RealWindow Map(const RealWindow& input) = 0;
+    BasicRealWindow<P> Map(const BasicRealWindow<P>& input);
+
+    /**
+     * Maps all values to [0..1], based on bounds, into a caller provided
+     * window.
+     * @param input Input values in whatever unit.
+     * @param output Window that receives the corresponding values, in the
+     *               [0..1] domain; must be the same size as input.
+     */
+    virtual void Map(std::span<const P> input, std::span<P> output) = 0;
 
     /**
      * Build a fitting value map.
@@ -60,13 +72,17 @@ public:
      * @param unit Unit.
      * @return New ValueMap instance.
      */
-    static std::unique_ptr<ValueMap> Build(ValueMapType type, double lower, double upper, std::string unit);
+    static std::unique_ptr<BasicValueMap> Build(ValueMapType type, double lower, double upper, std::string unit);
 };
 
+/* Value map for the default, double precision pipeline */
+using ValueMap = BasicValueMap<double>;
+
 /**
  * Specialization for linear maps.
  */
-class LinearValueMap : public ValueMap {
+template <class P>
+class LinearValueMap : public BasicValueMap<P> {
 public:
     LinearValueMap(double lower, double upper, const std::string& unit);
 
@@ -78,13 +94,15 @@ public:
      * NOTE: Transformation is
      *       x : [lower_ .. upper_] ---> [0 .. 1].
      */
-    RealWindow Map(const RealWindow& input) override;
+    using BasicValueMap<P>::Map;
+    void Map(std::span<const P> input, std::span<P> output) override;
 };
 
 /**
  * Specialization for logarithmic maps in some dB unit
  */
-class DecibelValueMap : public ValueMap {
+template <class P>
+class DecibelValueMap : public BasicValueMap<P> {
 public:
     /**
      * @param lower Lower bound.
@@ -101,7 +119,19 @@ public:
      * NOTE: Transformation is
      *       20*log10(x) : [lower_ .. upper_] ---> [0 .. 1].
      */
-    RealWindow Map(const RealWindow& input) override;
+    using BasicValueMap<P>::Map;
+    void Map(std::span<const P> input, std::span<P> output) override;
+
+    /**
+     * Logarithmically map the magnitude of complex values to output, in a
+     * single pass and without computing the magnitude (see
+     * MapPowerToDecibels()).
+     * @param input Complex values (e.g. FFT output).
+     * @param gain Gain applied to each value, in dB.
+     * @param output Window that receives the corresponding values, in the
+     *               [0..1] domain; must be the same size as input.
+     */
+    void MapPower(std::span<const std::complex<P>> input, double gain, std::span<P> output) const;
 
     /**
      * @return Unit with dB prefix.
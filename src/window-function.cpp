@@ -8,55 +8,81 @@
 
 #include <cassert>
 
-WindowFunction::WindowFunction(std::size_t window_size) : window_size_(window_size)
+template <class P>
+BasicWindowFunction<P>::BasicWindowFunction(std::size_t window_size) : window_size_(window_size)
 {
     cached_factors_.resize(window_size);
 }
 
-std::unique_ptr<WindowFunction>
-WindowFunction::Build(WindowFunctionType type, std::size_t window_size)
+template <class P>
+std::unique_ptr<BasicWindowFunction<P>>
+BasicWindowFunction<P>::Build(WindowFunctionType type, std::size_t window_size)
 {
     switch (type) {
         case WindowFunctionType::kNone:
             return nullptr; /* no window needed */
 
         case WindowFunctionType::kHann:
-            return std::make_unique<HannWindowFunction>(window_size);
+            return std::make_unique<HannWindowFunction<P>>(window_size);
 
         case WindowFunctionType::kHamming:
-            return std::make_unique<HammingWindowFunction>(window_size);
+            return std::make_unique<HammingWindowFunction<P>>(window_size);
 
         case WindowFunctionType::kBlackman:
-            return std::make_unique<BlackmanWindowFunction>(window_size);
+            return std::make_unique<BlackmanWindowFunction<P>>(window_size);
 
         case WindowFunctionType::kNuttall:
-            return std::make_unique<NuttallWindowFunction>(window_size);
+            return std::make_unique<NuttallWindowFunction<P>>(window_size);
 
         default:
             throw std::runtime_error("unknown window function");
     }
 }
 
-ComplexWindow
-WindowFunction::Apply(const ComplexWindow& window) const
+template <class P>
+BasicComplexWindow<P>
+BasicWindowFunction<P>::Apply(std::span<const ValueType> window) const
+{
+    BasicComplexWindow<P> output;
+    output.resize(window.size());
+    this->Apply(window, output);
+    return output;
+}
+
+template <class P>
+void
+BasicWindowFunction<P>::Apply(std::span<const ValueType> window, std::span<ValueType> output) const
 {
     /* only matching windows */
-    if (window.size() != this->window_size_) {
+    if (window.size() != this->window_size_ || output.size() != this->window_size_) {
         throw std::runtime_error("incorrect window size for window function application");
     }
     assert(this->cached_factors_.size() == this->window_size_);
 
-    ComplexWindow output;
-    output.resize(this->window_size_);
     for (std::size_t i = 0; i < this->window_size_; i++) {
         output[i] = window[i] * this->cached_factors_[i];
     }
-    return output;
 }
 
-GeneralizedCosineWindowFunction::GeneralizedCosineWindowFunction(std::size_t window_size,
-                                                                 const std::vector<double>& a)
-    : WindowFunction(window_size)
+template <class P>
+void
+BasicWindowFunction<P>::Apply(std::span<const ValueType> window, std::span<P> output) const
+{
+    /* only matching windows */
+    if (window.size() != this->window_size_ || output.size() != this->window_size_) {
+        throw std::runtime_error("incorrect window size for window function application");
+    }
+    assert(this->cached_factors_.size() == this->window_size_);
+
+    for (std::size_t i = 0; i < this->window_size_; i++) {
+        output[i] = window[i].real() * this->cached_factors_[i];
+    }
+}
+
+template <class P>
+GeneralizedCosineWindowFunction<P>::GeneralizedCosineWindowFunction(std::size_t window_size,
+                                                                    const std::vector<double>& a)
+    : BasicWindowFunction<P>(window_size)
 {
     if (this->window_size_ == 1) {
         /* noop case */
@@ -66,30 +92,38 @@ GeneralizedCosineWindowFunction::GeneralizedCosineWindowFunction(std::size_t win
 
     double N = (double)this->window_size_ - 1.0;
     for (std::size_t n = 0; n < this->window_size_; n++) {
-        this->cached_factors_[n] = 0;
+        /* always accumulate in double precision */
+        double factor = 0;
         for (unsigned int k = 0; k < a.size(); k++) {
-            this->cached_factors_[n] +=
-                std::pow<double>(-1.0f, k) * a[k] * std::cos(2.0 * (double)M_PI * k * (double)n / N);
+            factor += std::pow<double>(-1.0f, k) * a[k] * std::cos(2.0 * (double)M_PI * k * (double)n / N);
         }
+        this->cached_factors_[n] = static_cast<P>(factor);
     }
 }
 
-HannWindowFunction::HannWindowFunction(std::size_t window_size)
-    : GeneralizedCosineWindowFunction(window_size, { 0.5, 0.5 })
+template <class P>
+HannWindowFunction<P>::HannWindowFunction(std::size_t window_size)
+    : GeneralizedCosineWindowFunction<P>(window_size, { 0.5, 0.5 })
 {
 }
 
-HammingWindowFunction::HammingWindowFunction(std::size_t window_size)
-        : GeneralizedCosineWindowFunction(window_size, { 0.54, 0.46 })
+template <class P>
+HammingWindowFunction<P>::HammingWindowFunction(std::size_t window_size)
+        : GeneralizedCosineWindowFunction<P>(window_size, { 0.54, 0.46 })
 {
 }
 
-BlackmanWindowFunction::BlackmanWindowFunction(std::size_t window_size)
-        : GeneralizedCosineWindowFunction(window_size, { 0.42, 0.5, 0.08 })
+template <class P>
+BlackmanWindowFunction<P>::BlackmanWindowFunction(std::size_t window_size)
+        : GeneralizedCosineWindowFunction<P>(window_size, { 0.42, 0.5, 0.08 })
 {
 }
 
-NuttallWindowFunction::NuttallWindowFunction(std::size_t window_size)
-        : GeneralizedCosineWindowFunction(window_size, { 0.3635819, 0.4891775, 0.1365995, 0.0106411 })
+template <class P>
+NuttallWindowFunction<P>::NuttallWindowFunction(std::size_t window_size)
+        : GeneralizedCosineWindowFunction<P>(window_size, { 0.3635819, 0.4891775, 0.1365995, 0.0106411 })
 {
 }
+
+template class BasicWindowFunction<float>;
+template class BasicWindowFunction<double>;
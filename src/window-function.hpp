@@ -26,26 +26,50 @@ enum class WindowFunctionType {
 
 /**
  * Base window function class.
+ * @tparam P Precision of windows this function is applied to (float or double).
  */
-class WindowFunction {
+template <class P>
+class BasicWindowFunction {
+public:
+    /* type of window values */
+    using ValueType = std::complex<P>;
+
 protected:
     const std::size_t window_size_;         /* size of window */
-    std::vector<double> cached_factors_;    /* precomputed factors for each element in window */
+    std::vector<P> cached_factors_;         /* precomputed factors for each element in window */
 
     /**
      * @param window_size Window size.
      */
-    explicit WindowFunction(std::size_t window_size);
+    explicit BasicWindowFunction(std::size_t window_size);
 
 public:
-    WindowFunction() = delete;
+    BasicWindowFunction() = delete;
+    virtual ~BasicWindowFunction() = default;
 
     /**
      * Apply function to a window.
      * @param window Array of complex numbers.
      * @return Element-wise multiplication between window and precomputed factors.
      */
-    ComplexWindow Apply(const ComplexWindow& window) const;
+    BasicComplexWindow<P> Apply(std::span<const ValueType> window) const;
+
+    /**
+     * Apply function to a window, into a caller provided window.
+     * @param window Array of complex numbers.
+     * @param output Window of the same size that receives the element-wise
+     *               multiplication between window and precomputed factors.
+     */
+    void Apply(std::span<const ValueType> window, std::span<ValueType> output) const;
+
+    /**
+     * Apply function to the real part of a window, into a caller provided window.
+     * @param window Array of complex numbers.
+     * @param output Window of the same size that receives the element-wise
+     *               multiplication between the real part of window and
+     *               precomputed factors.
+     */
+    void Apply(std::span<const ValueType> window, std::span<P> output) const;
 
     /**
      * Build a fitting window function.
@@ -53,13 +77,17 @@ public:
      * @param window_size Size of window.
      * @return New WindowFunction instance.
      */
-    static std::unique_ptr<WindowFunction> Build(WindowFunctionType type, std::size_t window_size);
+    static std::unique_ptr<BasicWindowFunction> Build(WindowFunctionType type, std::size_t window_size);
 };
 
+/* Window function for the default, double precision pipeline */
+using WindowFunction = BasicWindowFunction<double>;
+
 /**
  * Specialization for generalized cosine window functions.
  */
-class GeneralizedCosineWindowFunction : public WindowFunction {
+template <class P>
+class GeneralizedCosineWindowFunction : public BasicWindowFunction<P> {
 protected:
 public:
     /**
@@ -72,7 +100,8 @@ public:
 /**
  * Specialization for Hann windows.
  */
-class HannWindowFunction : public GeneralizedCosineWindowFunction {
+template <class P>
+class HannWindowFunction : public GeneralizedCosineWindowFunction<P> {
 public:
     explicit HannWindowFunction(std::size_t window_size);
 };
@@ -80,7 +109,8 @@ public:
 /**
  * Specialization for Hamming windows.
  */
-class HammingWindowFunction : public GeneralizedCosineWindowFunction {
+template <class P>
+class HammingWindowFunction : public GeneralizedCosineWindowFunction<P> {
 public:
     explicit HammingWindowFunction(std::size_t window_size);
 };
@@ -88,7 +118,8 @@ public:
 /**
  * Specialization for Blackman windows.
  */
-class BlackmanWindowFunction : public GeneralizedCosineWindowFunction {
+template <class P>
+class BlackmanWindowFunction : public GeneralizedCosineWindowFunction<P> {
 public:
     explicit BlackmanWindowFunction(std::size_t window_size);
 };
@@ -96,7 +127,8 @@ public:
 /**
  * Specialization for Nuttall windows.
  */
-class NuttallWindowFunction : public GeneralizedCosineWindowFunction {
+template <class P>
+class NuttallWindowFunction : public GeneralizedCosineWindowFunction<P> {
 public:
     explicit NuttallWindowFunction(std::size_t window_size);
 };
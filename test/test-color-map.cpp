@@ -96,7 +96,9 @@ TEST(TestColorMap, InterpolationColorMap)
             auto out = map.Gradient(steps);
             EXPECT_EQ(out.size(), 4 * steps);
             for (std::size_t i = 0; i < steps; i++) {
-                double ev = (double)i / (double)(steps-1);
+                /* colors come from the nearest lookup table entry */
+                constexpr double res = (double)InterpolationColorMap::DEFAULT_LUT_RESOLUTION;
+                double ev = std::round((double)i / (double)(steps-1) * res) / res;
                 uint8_t color = (uint8_t)std::round(ev * 255.0);
                 EXPECT_EQ(out[i * 4 + 0], color);
                 EXPECT_EQ(out[i * 4 + 1], color);
@@ -200,7 +202,9 @@ TEST(TestColorMap, TwoColorMap)
             auto out = map.Gradient(steps);
             EXPECT_EQ(out.size(), 4 * steps);
             for (std::size_t i = 0; i < steps; i++) {
-                double ev = (double)i / (double)(steps-1);
+                /* colors come from the nearest lookup table entry */
+                constexpr double res = (double)InterpolationColorMap::DEFAULT_LUT_RESOLUTION;
+                double ev = std::round((double)i / (double)(steps-1) * res) / res;
                 uint8_t color = (uint8_t)std::round(ev * 255.0);
                 EXPECT_EQ(out[i * 4 + 0], color);
                 EXPECT_EQ(out[i * 4 + 1], color);
@@ -289,3 +293,63 @@ TEST(TestColorMap, CopyColorMap)
         }
     }
 }
+
+TEST(TestColorMap, MapIntoBuffer)
+{
+    RealWindow input { 0.0, 0.1, 0.25, 0.5, 0.9, 1.0 };
+    auto map = ColorMap::Build(ColorMapType::kJet, sf::Color::Black, sf::Color::White);
+
+    /* same as the allocating overload */
+    auto expected = map->Map(input);
+    std::vector<uint8_t> output(input.size() * 4);
+    map->Map(input, output);
+    EXPECT_EQ(output, expected);
+
+    EXPECT_THROW_MATCH(map->Map(input, std::span<uint8_t>(output).first(5)),
+                       std::runtime_error, "output size must be four times the input size");
+}
+
+TEST(TestColorMap, LookupTable)
+{
+    EXPECT_THROW_MATCH(InterpolationColorMap({ BLACK, WHITE }, { 0.0, 1.0 }, 0),
+                       std::runtime_error, "colormap lookup table resolution must be positive");
+
+    /* coarse table; values map to the nearest of 0.0, 0.25, 0.5, 0.75 and 1.0 */
+    InterpolationColorMap map({ BLACK, WHITE }, { 0.0, 1.0 }, 4);
+    EXPECT_EQ(map.GetLUTResolution(), 4);
+    auto out = map.Map({ 0.0, 0.12, 0.13, 0.5, 0.74, 0.876, 1.0 });
+    std::vector<uint8_t> expected { 0, 0, 64, 128, 191, 255, 255 };
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(out[i * 4 + 0], expected[i]);
+        EXPECT_EQ(out[i * 4 + 3], 255);
+    }
+
+    /* copies keep the resolution */
+    auto copy = map.Copy();
+    EXPECT_EQ(copy->Map({ 0.13, 0.74 }), map.Map({ 0.13, 0.74 }));
+
+    /* default resolution is within one step of exact interpolation */
+    InterpolationColorMap fine({ BLACK, WHITE }, { 0.0, 1.0 });
+    for (std::size_t i = 0; i <= 1000; i++) {
+        double value = (double)i / 1000.0;
+        EXPECT_LE(std::abs(fine.Map({ value })[0] - value * 255.0), 1.0);
+    }
+}
+
+TEST(TestColorMap, MapQuantized)
+{
+    auto map = ColorMap::Build(ColorMapType::kJet, sf::Color::Black, sf::Color::White);
+
+    /* same colors as the corresponding real values */
+    std::vector<uint16_t> input { 0, 1, 6554, 16384, 32768, 58982, 65534, 65535 };
+    RealWindow real_input;
+    for (auto v : input) {
+        real_input.push_back((double)v / 65535.0);
+    }
+    std::vector<uint8_t> output(input.size() * 4);
+    map->Map(input, output);
+    EXPECT_EQ(output, map->Map(real_input));
+
+    EXPECT_THROW_MATCH(map->Map(input, std::span<uint8_t>(output).first(5)),
+                       std::runtime_error, "output size must be four times the input size");
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/decibel-conversion.hpp"
+#include "../src/value-map.hpp"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+template <class P>
+static void
+test_decibels()
+{
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::uniform_real_distribution<double> ud(-9.0, 1.0);
+    std::uniform_real_distribution<double> ua(0.0, 2.0 * M_PI);
+
+    for (std::size_t count = 0; count < 70; count++) {
+        /* magnitudes spread over [-180 .. 20] dB */
+        std::vector<std::complex<P>> input(count);
+        for (auto& v : input) {
+            v = std::polar<P>(std::pow(10.0, ud(re)), ua(re));
+        }
+        if (count > 3) {
+            input[0] = 0.0;
+            input[1] = std::complex<P>(std::numeric_limits<P>::quiet_NaN(), 0.0);
+            input[2] = 1e-3;
+            input[3] = std::numeric_limits<P>::infinity();
+        }
+
+        std::vector<P> reference;
+        for (auto level : { SimdLevel::kNone, SimdLevel::kSSE2, SimdLevel::kAVX2 }) {
+            std::vector<P> output(count, -5.0);
+            MapPowerToDecibels<P>(input, 3.0, -120.0, 0.0, output, level);
+
+            for (std::size_t i = 0; i < count; i++) {
+                double db = 20.0 * std::log10(std::abs(std::complex<double>(input[i]))) + 3.0;
+                double expected = std::clamp((db + 120.0) / 120.0, 0.0, 1.0);
+                if (std::isnan(db)) {
+                    expected = 0.0;
+                }
+                EXPECT_NEAR(output[i], expected, 1e-6);
+            }
+
+            /* all kernels compute the same values */
+            if (reference.empty()) {
+                reference = output;
+            }
+            EXPECT_EQ(output, reference);
+        }
+    }
+
+    /* -120dB + 3dB gain is 1.0/40.0 */
+    std::vector<std::complex<P>> input { 1e-6 };
+    std::vector<P> output(1);
+    MapPowerToDecibels<P>(input, 3.0, -120.0, 0.0, output);
+    EXPECT_NEAR(output[0], 1.0 / 40.0, 1e-6);
+
+    EXPECT_THROW_MATCH(MapPowerToDecibels<P>(input, 0.0, -120.0, 0.0, std::span<P>()),
+                       std::runtime_error, "output window size must match input size");
+}
+
+TEST(TestDecibelConversion, SinglePrecision)
+{
+    test_decibels<float>();
+}
+
+TEST(TestDecibelConversion, DoublePrecision)
+{
+    test_decibels<double>();
+}
+
+TEST(TestDecibelConversion, DecibelValueMap)
+{
+    /* single pass over complex values matches magnitude followed by the regular map */
+    DecibelValueMap<double> map(-100.0, -10.0, "FS");
+    ComplexWindow input { 1e-3, std::complex<double>(0.0, 0.5), std::complex<double>(1e-4, -1e-4), 1e-6, 0.3 };
+    RealWindow magnitude(input.size());
+    for (std::size_t i = 0; i < input.size(); i++) {
+        magnitude[i] = std::abs(input[i]) * 2.0;
+    }
+    auto expected = map.Map(magnitude);
+
+    RealWindow output(input.size());
+    map.MapPower(input, 20.0 * std::log10(2.0), output);
+    for (std::size_t i = 0; i < input.size(); i++) {
+        EXPECT_NEAR(output[i], expected[i], 1e-6);
+    }
+}
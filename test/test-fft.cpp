@@ -6,8 +6,12 @@
  */
 #include "test.hpp"
 #include "../src/fft.hpp"
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <random>
+#include <limits>
+#include <cstdio>
 
 void run_tests(const std::vector<double>& freqs, std::vector<ComplexWindow>& expected, std::size_t window_size, double fs)
 {
@@ -353,3 +357,410 @@ TEST(TestFFT, Resample)
         for (auto v : out) { EXPECT_EQ(v, 0.0); }
     }
 }
+
+TEST(TestFFT, SinglePrecision)
+{
+    constexpr std::size_t window_size = 250;
+    constexpr double epsilon = 1e-5;
+
+    /* same window function, in both precisions */
+    auto wf_double = BasicWindowFunction<double>::Build(WindowFunctionType::kHann, window_size);
+    auto wf_float = BasicWindowFunction<float>::Build(WindowFunctionType::kHann, window_size);
+    BasicFFT<double> fft_double(window_size, wf_double);
+    BasicFFT<float> fft_float(window_size, wf_float);
+
+    /* sum of two sinusoids */
+    BasicComplexWindow<double> input_double(window_size);
+    BasicComplexWindow<float> input_float(window_size);
+    for (std::size_t j = 0; j < window_size; j++) {
+        auto value = 0.7 * std::exp(std::complex<double>(0.0, 2.0 * M_PI * 0.1 * (double)j))
+                     + 0.2 * std::exp(std::complex<double>(0.0, -2.0 * M_PI * 0.33 * (double)j));
+        input_double[j] = value;
+        input_float[j] = std::complex<float>(value);
+    }
+
+    /* single precision must closely follow double precision, throughout */
+    auto out_double = fft_double.Compute(input_double);
+    auto out_float = fft_float.Compute(input_float);
+    ASSERT_EQ(out_double.size(), out_float.size());
+    for (std::size_t j = 0; j < window_size; j++) {
+        EXPECT_LE(std::abs(out_double[j] - std::complex<double>(out_float[j])), epsilon);
+    }
+
+    auto mag_double = BasicFFT<double>::GetMagnitude(out_double, true);
+    auto mag_float = BasicFFT<float>::GetMagnitude(out_float, true);
+    auto res_double = BasicFFT<double>::Resample(mag_double, 1000.0, 100, 0.0, 400.0);
+    auto res_float = BasicFFT<float>::Resample(mag_float, 1000.0, 100, 0.0, 400.0);
+    ASSERT_EQ(res_double.size(), res_float.size());
+    for (std::size_t j = 0; j < res_double.size(); j++) {
+        EXPECT_LE(std::abs(res_double[j] - res_float[j]), epsilon);
+    }
+}
+
+TEST(TestFFT, RealInput)
+{
+    constexpr double epsilon = 1e-9;
+
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::uniform_real_distribution<double> ud(-1.0, 1.0);
+
+    for (std::size_t width : { 1, 2, 3, 8, 9, 64, 255, 256 }) {
+        auto wf_complex = WindowFunction::Build(WindowFunctionType::kHamming, width);
+        auto wf_real = WindowFunction::Build(WindowFunctionType::kHamming, width);
+        FFT fft_complex(width, wf_complex, false);
+        FFT fft_real(width, wf_real, true);
+        EXPECT_FALSE(fft_complex.IsRealInput());
+        EXPECT_TRUE(fft_real.IsRealInput());
+
+        ComplexWindow input(width);
+        for (auto& v : input) {
+            v = Complex(ud(re), 0.0);
+        }
+
+        /* real transform yields the non-negative half of the complex transform */
+        auto out_complex = fft_complex.Compute(input);
+        auto out_real = fft_real.Compute(input);
+        ASSERT_EQ(out_real.size(), width / 2 + 1);
+        auto uhl = (width - 1) / 2;
+        for (std::size_t k = 0; k < out_real.size(); k++) {
+            EXPECT_LE(std::abs(out_real[k] - out_complex[uhl + k]), epsilon);
+        }
+
+        /* magnitudes match those of the full spectrum, once mirrored */
+        for (bool alias : { false, true }) {
+            auto mag_complex = FFT::GetMagnitude(out_complex, alias);
+            auto mag_real = FFT::MirrorHalfSpectrum(FFT::GetHalfSpectrumMagnitude(out_real, width, alias), width);
+            ASSERT_EQ(mag_real.size(), mag_complex.size());
+            for (std::size_t k = 0; k < width; k++) {
+                EXPECT_LE(std::abs(mag_real[k] - mag_complex[k]), epsilon);
+            }
+        }
+    }
+
+    /* bad half spectrum sizes */
+    EXPECT_THROW_MATCH(FFT::GetHalfSpectrumMagnitude(ComplexWindow(4), 8, true),
+                       std::runtime_error, "half spectrum size does not match FFT width");
+    EXPECT_THROW_MATCH(FFT::MirrorHalfSpectrum(RealWindow(6), 8),
+                       std::runtime_error, "half spectrum size does not match FFT width");
+}
+
+TEST(TestFFT, Planners)
+{
+    constexpr std::size_t window_size = 64;
+    constexpr double epsilon = 1e-9;
+
+    ComplexWindow input(window_size);
+    for (std::size_t j = 0; j < window_size; j++) {
+        input[j] = Complex(std::cos(2.0 * M_PI * 0.2 * (double)j) + 0.1 * (double)j, 0.0);
+    }
+
+    /* rigorous planners may pick different algorithms, but must compute the same transform */
+    std::unique_ptr<WindowFunction> no_wf;
+    FFT fft_estimate(window_size, no_wf, false, FFTPlanner::kEstimate);
+    auto expected = fft_estimate.Compute(input);
+    for (auto planner : { FFTPlanner::kMeasure, FFTPlanner::kPatient }) {
+        for (bool real_input : { false, true }) {
+            FFT fft(window_size, no_wf, real_input, planner);
+            auto out = fft.Compute(input);
+            auto offset = real_input ? (window_size - 1) / 2 : 0;
+            for (std::size_t k = 0; k < out.size(); k++) {
+                EXPECT_LE(std::abs(out[k] - expected[offset + k]), epsilon);
+            }
+        }
+    }
+
+    /* wisdom survives a round trip through a file */
+    std::string filename = "/tmp/specgram-test-wisdom";
+    EXPECT_TRUE(FFT::ExportWisdom(filename));
+    EXPECT_TRUE(FFT::ImportWisdom(filename));
+    std::remove(filename.c_str());
+    EXPECT_FALSE(FFT::ImportWisdom("/nonexistent/specgram-test-wisdom"));
+}
+
+TEST(TestFFT, Batch)
+{
+    constexpr std::size_t batch_size = 5;
+    constexpr double epsilon = 1e-9;
+
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::uniform_real_distribution<double> ud(-1.0, 1.0);
+
+    for (std::size_t width : { 1, 2, 7, 64 }) {
+        for (bool real_input : { false, true }) {
+            auto wf_single = WindowFunction::Build(WindowFunctionType::kBlackman, width);
+            auto wf_batch = WindowFunction::Build(WindowFunctionType::kBlackman, width);
+            FFT fft_single(width, wf_single, real_input);
+            FFT fft_batch(width, wf_batch, real_input, FFTPlanner::kEstimate, batch_size);
+            EXPECT_EQ(fft_single.GetBatchSize(), 1);
+            EXPECT_EQ(fft_batch.GetBatchSize(), batch_size);
+
+            /* full and partial batches */
+            for (std::size_t count : { batch_size, (std::size_t)2, (std::size_t)1 }) {
+                std::vector<ComplexWindow> inputs(count, ComplexWindow(width));
+                for (auto& input : inputs) {
+                    for (auto& v : input) {
+                        v = Complex(ud(re), real_input ? 0.0 : ud(re));
+                    }
+                    fft_batch.Stage(input);
+                }
+                EXPECT_EQ(fft_batch.GetStagedCount(), count);
+
+                /* batched windows are transformed exactly like single ones */
+                auto outputs = fft_batch.ComputeBatch();
+                EXPECT_EQ(fft_batch.GetStagedCount(), 0);
+                ASSERT_EQ(outputs.size(), count);
+                for (std::size_t i = 0; i < count; i++) {
+                    auto expected = fft_single.Compute(inputs[i]);
+                    ASSERT_EQ(outputs[i].size(), expected.size());
+                    for (std::size_t k = 0; k < expected.size(); k++) {
+                        EXPECT_LE(std::abs(outputs[i][k] - expected[k]), epsilon);
+                    }
+                }
+            }
+
+            /* nothing staged */
+            EXPECT_TRUE(fft_batch.ComputeBatch().empty());
+        }
+    }
+
+    /* misuse */
+    std::unique_ptr<WindowFunction> no_wf;
+    EXPECT_THROW_MATCH(FFT(8, no_wf, false, FFTPlanner::kEstimate, 0),
+                       std::runtime_error, "fft batch size must be positive");
+    FFT fft(8, no_wf, false, FFTPlanner::kEstimate, 2);
+    ComplexWindow input(8);
+    fft.Stage(input);
+    EXPECT_THROW_MATCH(fft.Compute(input),
+                       std::runtime_error, "cannot compute a single window while windows are staged");
+    fft.Stage(input);
+    EXPECT_THROW_MATCH(fft.Stage(input), std::runtime_error, "fft batch is full");
+    EXPECT_THROW_MATCH(FFT(8, no_wf, false, FFTPlanner::kEstimate, 2).Stage(ComplexWindow(4)),
+                       std::runtime_error, "input window size must match FFTW plan size");
+}
+
+TEST(TestFFT, IntoWindows)
+{
+    constexpr std::size_t width = 16;
+
+    ComplexWindow input(width);
+    for (std::size_t j = 0; j < width; j++) {
+        input[j] = Complex(std::cos(2.0 * M_PI * 0.25 * (double)j), 0.0);
+    }
+
+    for (bool real_input : { false, true }) {
+        std::unique_ptr<WindowFunction> no_wf;
+        FFT fft(width, no_wf, real_input, FFTPlanner::kEstimate, 2);
+        EXPECT_EQ(fft.GetOutputWidth(), real_input ? width / 2 + 1 : width);
+
+        /* single window */
+        auto expected = fft.Compute(input);
+        ComplexWindow output(fft.GetOutputWidth());
+        fft.Compute(input, output);
+        EXPECT_EQ(output, expected);
+        EXPECT_THROW_MATCH(fft.Compute(input, std::span<Complex>(output).first(3)),
+                           std::runtime_error, "output window size must match FFT output size");
+
+        /* batch */
+        ComplexWindow batch_output(2 * fft.GetOutputWidth());
+        fft.Stage(input);
+        fft.Stage(input);
+        EXPECT_THROW_MATCH(fft.ComputeBatch(std::span<Complex>(batch_output).first(3)),
+                           std::runtime_error, "output too small for fft batch");
+        EXPECT_EQ(fft.ComputeBatch(batch_output), 2);
+        EXPECT_EQ(ComplexWindow(batch_output.begin(), batch_output.begin() + fft.GetOutputWidth()), expected);
+        EXPECT_EQ(ComplexWindow(batch_output.begin() + fft.GetOutputWidth(), batch_output.end()), expected);
+    }
+
+    /* magnitudes and mirroring */
+    std::unique_ptr<WindowFunction> no_wf;
+    FFT fft_real(width, no_wf, true);
+    auto half = fft_real.Compute(input);
+    RealWindow half_magnitude(half.size());
+    FFT::GetHalfSpectrumMagnitude(half, width, true, half_magnitude);
+    EXPECT_EQ(half_magnitude, FFT::GetHalfSpectrumMagnitude(half, width, true));
+    RealWindow mirrored(width);
+    FFT::MirrorHalfSpectrum(half_magnitude, width, mirrored);
+    EXPECT_EQ(mirrored, FFT::MirrorHalfSpectrum(half_magnitude, width));
+
+    FFT fft_complex(width);
+    auto full = fft_complex.Compute(input);
+    RealWindow magnitude(width);
+    FFT::GetMagnitude(full, true, magnitude);
+    EXPECT_EQ(magnitude, FFT::GetMagnitude(full, true));
+    EXPECT_THROW_MATCH(FFT::GetMagnitude(full, true, std::span<double>(magnitude).first(3)),
+                       std::runtime_error, "magnitude window size must match input size");
+
+    /* resampling and cropping */
+    RealWindow resampled(10);
+    FFT::Resample(magnitude, 1.0, -0.25, 0.4, resampled);
+    EXPECT_EQ(resampled, FFT::Resample(magnitude, 1.0, 10, -0.25, 0.4));
+    auto expected_crop = FFT::Crop(magnitude, 1.0, -0.25, 0.4);
+    RealWindow cropped(expected_crop.size());
+    FFT::Crop(magnitude, 1.0, -0.25, 0.4, cropped);
+    EXPECT_EQ(cropped, expected_crop);
+    EXPECT_THROW_MATCH(FFT::Crop(magnitude, 1.0, -0.25, 0.4, std::span<double>(cropped).first(1)),
+                       std::runtime_error, "output window size must match cropped size");
+}
+
+TEST(TestFFT, ResamplePlan)
+{
+    EXPECT_THROW_MATCH(ResamplePlan(16, 0.0, 8, -0.375, 0.5),
+                       std::runtime_error, "rate must be positive for resampling");
+    EXPECT_THROW_MATCH(ResamplePlan(16, 1.0, 8, 0.5, 0.5),
+                       std::runtime_error, "resampling frequency bounds either not distinct or not in order");
+    EXPECT_THROW_MATCH(ResamplePlan(16, 1.0, 0, 0.0, 0.1),
+                       std::runtime_error, "resampling requires positive width");
+
+    /* reference, evaluating the Lanczos kernel for every tap */
+    auto lanczos_resample = [](const RealWindow& input, double rate, std::size_t width, double fmin, double fmax) {
+        auto sinc = [](double x) { return std::abs(x) < 1e-9 ? 1.0 : std::sin(x) / x; };
+        double i_fmin = FFT::GetFrequencyIndex(rate, input.size(), fmin);
+        double i_fmax = FFT::GetFrequencyIndex(rate, input.size(), fmax);
+        RealWindow output(width);
+        for (std::size_t j = 0; j < width; j++) {
+            double x = (width > 1) ? (double)j / (double)(width - 1) * (i_fmax - i_fmin) + i_fmin
+                                   : (i_fmin + i_fmax) / 2.0;
+            double sum = 0.0, lsum = 0.0;
+            for (int i = (int)std::floor(x) - 2; i <= (int)std::floor(x) + 3; i++) {
+                if (i >= 0 && i < (int)input.size()) {
+                    double lanc_xi = sinc(x - i) * sinc((x - i) / 3.0);
+                    sum += input[i] * lanc_xi;
+                    lsum += lanc_xi;
+                }
+            }
+            double value = sum / lsum;
+            output[j] = std::clamp(std::isnan(value) ? 0.0 : value, 0.0, 1.0);
+        }
+        return output;
+    };
+
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::uniform_real_distribution<double> ud(0.0, 1.0);
+
+    /* bands inside, overlapping and outside of the input; both up- and downsampling, and a single output value */
+    for (auto [width, fmin, fmax] : { std::make_tuple(7, -0.3, 0.2), std::make_tuple(100, -0.5, 0.5),
+                                      std::make_tuple(33, 0.3, 0.9), std::make_tuple(5, 2.0, 3.0),
+                                      std::make_tuple(1, -0.3, 0.2), std::make_tuple(1, 0.3, 0.9) }) {
+        ResamplePlan plan(50, 1.0, width, fmin, fmax);
+        EXPECT_EQ(plan.GetInputSize(), 50);
+        EXPECT_EQ(plan.GetOutputSize(), width);
+
+        /* plan is reusable across windows */
+        for (int k = 0; k < 3; k++) {
+            RealWindow input(50);
+            for (auto& v : input) {
+                v = ud(re);
+            }
+            RealWindow output(width);
+            plan.Apply(input, output);
+            auto expected = lanczos_resample(input, 1.0, width, fmin, fmax);
+            for (std::size_t j = 0; j < output.size(); j++) {
+                EXPECT_NEAR(output[j], expected[j], 1e-12);
+            }
+            EXPECT_EQ(output, FFT::Resample(input, 1.0, width, fmin, fmax));
+
+            /* all kernels compute the same values */
+            for (auto level : { SimdLevel::kNone, SimdLevel::kSSE2, SimdLevel::kAVX2 }) {
+                RealWindow level_output(width);
+                plan.Apply(input, level_output, level);
+                EXPECT_EQ(level_output, output);
+            }
+        }
+    }
+
+    ResamplePlan plan(16, 1.0, 4, 0.0, 0.5);
+    RealWindow input(16, 0.5), output(4);
+    EXPECT_THROW_MATCH(plan.Apply(std::span<const double>(input).first(15), output),
+                       std::runtime_error, "input size does not match resample plan");
+    EXPECT_THROW_MATCH(plan.Apply(input, std::span<double>(output).first(3)),
+                       std::runtime_error, "output size does not match resample plan");
+
+    BasicResamplePlan<float> plan_f(16, 1.0, 4, 0.0, 0.5);
+    BasicRealWindow<float> input_f(16, 0.5f), output_f(4);
+    plan_f.Apply(input_f, output_f);
+    for (auto v : output_f) {
+        EXPECT_NEAR(v, 0.5f, 1e-6);
+    }
+
+    /* single precision kernels agree as well, on a band with edges and a vectorized interior */
+    BasicResamplePlan<float> wide_plan_f(50, 1.0, 41, -0.5, 0.5);
+    BasicRealWindow<float> wide_input_f(50), reference_f(41);
+    for (auto& v : wide_input_f) {
+        v = ud(re);
+    }
+    wide_plan_f.Apply(wide_input_f, reference_f, SimdLevel::kNone);
+    for (auto level : { SimdLevel::kSSE2, SimdLevel::kAVX2 }) {
+        BasicRealWindow<float> level_output_f(41);
+        wide_plan_f.Apply(wide_input_f, level_output_f, level);
+        EXPECT_EQ(level_output_f, reference_f);
+    }
+
+    /* taps past the last bin do not reach it; an infinite edge bin saturates its output instead of blanking it */
+    input[15] = std::numeric_limits<double>::infinity();
+    plan.Apply(input, output);
+    EXPECT_NEAR(output[0], 0.5, 1e-12);
+    EXPECT_EQ(output[3], 1.0);
+}
+
+TEST(TestFFT, ResamplePooling)
+{
+    EXPECT_THROW_MATCH(ResamplePlan(16, 1.0, 8, 0.5, 0.5, FrequencyReduction::kMax),
+                       std::runtime_error, "resampling frequency bounds either not distinct or not in order");
+
+    /* 1024 bins over [-0.5, 0.5], downsampled to 16 values; a single bin carrier must always show up */
+    constexpr std::size_t size = 1024;
+    constexpr std::size_t width = 16;
+    auto [in_fmin, in_fmax] = FFT::GetFrequencyLimits(1.0, size);
+    ResamplePlan lanczos(size, 1.0, width, in_fmin, in_fmax);
+    ResamplePlan max(size, 1.0, width, in_fmin, in_fmax, FrequencyReduction::kMax);
+    ResamplePlan mean(size, 1.0, width, in_fmin, in_fmax, FrequencyReduction::kMean);
+    EXPECT_EQ(max.GetReduction(), FrequencyReduction::kMax);
+
+    bool lanczos_missed = false;
+    for (std::size_t carrier = 0; carrier < size; carrier++) {
+        RealWindow input(size, 0.0), output(width);
+        input[carrier] = 1.0;
+
+        max.Apply(input, output);
+        EXPECT_EQ(std::count(output.begin(), output.end(), 1.0), 1);
+        EXPECT_EQ(std::count(output.begin(), output.end(), 0.0), width - 1);
+        auto column = std::find(output.begin(), output.end(), 1.0) - output.begin();
+
+        /* every bin is pooled exactly once, by the same column in both reductions */
+        mean.Apply(input, output);
+        EXPECT_GT(output[column], 0.0);
+        EXPECT_EQ(std::count(output.begin(), output.end(), 0.0), width - 1);
+
+        lanczos.Apply(input, output);
+        lanczos_missed |= (*std::max_element(output.begin(), output.end()) < 0.5);
+    }
+    EXPECT_TRUE(lanczos_missed);
+
+    /* mean of a ramp is the ramp value at the center of each column */
+    {
+        RealWindow input(size), output(width);
+        for (std::size_t i = 0; i < size; i++) {
+            input[i] = (double)i / (double)(size - 1);
+        }
+        mean.Apply(input, output);
+        for (std::size_t j = 1; j + 1 < width; j++) {
+            EXPECT_NEAR(output[j], (double)j / (double)(width - 1), 1e-3);
+        }
+    }
+
+    /* upsampling picks the nearest bin; bands outside of input are zero */
+    {
+        RealWindow input { 0.1, 0.2, 0.3, 0.4 }, output(7);
+        ResamplePlan up(4, 1.0, 7, -0.25, 0.5, FrequencyReduction::kMax);
+        up.Apply(input, output);
+        EXPECT_EQ(output, RealWindow({ 0.1, 0.2, 0.2, 0.3, 0.3, 0.4, 0.4 }));
+
+        ResamplePlan outside(4, 1.0, 3, 2.0, 3.0, FrequencyReduction::kMean);
+        RealWindow out_outside(3);
+        outside.Apply(input, out_outside);
+        EXPECT_EQ(out_outside, RealWindow(3, 0.0));
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/history.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+TEST(TestHistory, Errors)
+{
+    EXPECT_THROW_MATCH(History(0), std::runtime_error, "history width must be positive");
+
+    History history(4);
+    EXPECT_THROW_MATCH(history.AddRow(std::vector<double>(3, 0.0)),
+                       std::runtime_error, "row size must match history width");
+    EXPECT_THROW_MATCH(history.GetRow(0), std::runtime_error, "history row index out of range");
+    EXPECT_THROW_MATCH(history.Append(History(5)), std::runtime_error, "history widths differ");
+}
+
+TEST(TestHistory, Quantization)
+{
+    History history(7);
+    std::vector<double> row { 0.0, 1.0, 0.5, -0.1, 1.1, std::numeric_limits<double>::quiet_NaN(), 0.25 };
+    history.AddRow(row);
+    EXPECT_EQ(history.GetRowCount(), 1);
+    EXPECT_EQ(history.GetWidth(), 7);
+
+    auto stored = history.GetRow(0);
+    std::vector<History::ValueType> expected { 0, 65535, 32768, 0, 65535, 0, 16384 };
+    EXPECT_EQ(std::vector<History::ValueType>(stored.begin(), stored.end()), expected);
+}
+
+TEST(TestHistory, Chunks)
+{
+    /* 3 values of 2 bytes per row; 16 byte chunks hold 2 rows */
+    History history(3, 16);
+    History small_chunks(3, 1);
+    for (std::size_t i = 0; i < 11; i++) {
+        std::vector<double> row { (double)i / 10.0, 0.5, 1.0 - (double)i / 10.0 };
+        history.AddRow(row);
+        small_chunks.AddRow(row);
+
+        /* rows stay in place when chunks are added */
+        EXPECT_EQ(history.GetRow(0)[0], 0);
+    }
+    EXPECT_EQ(history.GetRowCount(), 11);
+
+    for (std::size_t i = 0; i < 11; i++) {
+        auto row = history.GetRow(i);
+        EXPECT_EQ(row.size(), 3);
+        EXPECT_EQ(row[0], (History::ValueType)std::round((double)i / 10.0 * 65535.0));
+        EXPECT_EQ(row[1], 32768);
+        EXPECT_EQ(row[2], (History::ValueType)std::round((1.0 - (double)i / 10.0) * 65535.0));
+        EXPECT_TRUE(std::equal(row.begin(), row.end(), small_chunks.GetRow(i).begin()));
+    }
+
+    /* appending keeps order, regardless of chunk boundaries */
+    History stitched(3, 16);
+    stitched.AddRow(std::vector<double>{ 1.0, 1.0, 1.0 });
+    stitched.Append(history);
+    stitched.Append(History(3));
+    EXPECT_EQ(stitched.GetRowCount(), 12);
+    EXPECT_EQ(stitched.GetRow(0)[0], 65535);
+    for (std::size_t i = 0; i < 11; i++) {
+        auto row = stitched.GetRow(i + 1);
+        EXPECT_TRUE(std::equal(row.begin(), row.end(), history.GetRow(i).begin()));
+    }
+}
+
+TEST(TestHistory, ReleaseRows)
+{
+    /* 2 rows per chunk */
+    History history(3, 16);
+    for (std::size_t i = 0; i < 7; i++) {
+        history.AddRow(std::vector<double>{ (double)i / 10.0, 0.5, 0.5 });
+    }
+    EXPECT_EQ(history.GetFirstRowIndex(), 0);
+
+    /* only whole chunks are released */
+    history.ReleaseRowsBefore(1);
+    EXPECT_EQ(history.GetFirstRowIndex(), 0);
+    history.ReleaseRowsBefore(5);
+    EXPECT_EQ(history.GetFirstRowIndex(), 4);
+    EXPECT_THROW_MATCH(history.GetRow(3), std::runtime_error, "history row was released");
+    for (std::size_t i = 4; i < 7; i++) {
+        EXPECT_EQ(history.GetRow(i)[0], (History::ValueType)std::round((double)i / 10.0 * 65535.0));
+    }
+
+    /* releasing everything keeps indices going */
+    history.ReleaseRowsBefore(100);
+    EXPECT_EQ(history.GetFirstRowIndex(), 6);
+    history.AddRow(std::vector<double>{ 1.0, 1.0, 1.0 });
+    history.ReleaseRowsBefore(100);
+    EXPECT_EQ(history.GetFirstRowIndex(), 8);
+    history.AddRow(std::vector<double>{ 1.0, 0.0, 1.0 });
+    EXPECT_EQ(history.GetRowCount(), 9);
+    EXPECT_EQ(history.GetRow(8)[1], 0);
+    EXPECT_THROW_MATCH(history.GetRow(7), std::runtime_error, "history row was released");
+}
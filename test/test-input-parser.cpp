@@ -164,8 +164,10 @@ TEST(TestInputParser, ParseBlockWrongSize)
                 if ((bs % parser->GetDataTypeSize()) == 0) {
                     EXPECT_NO_THROW(parser->ParseBlock(std::vector<char>(bs)));
                 } else {
+                    auto buffered = parser->GetBufferedValueCount();
                     EXPECT_THROW_MATCH(parser->ParseBlock(std::vector<char>(bs)),
                                        std::runtime_error, "block size must be a multiple of sizeof(datatype)");
+                    EXPECT_EQ(parser->GetBufferedValueCount(), buffered);
                 }
             }
         }
@@ -422,7 +424,7 @@ TEST(TestInputParser, ParseBlock)
 
                     /* retrieve parsed */
                     if (parsed_count > 0) {
-                        std::vector<Complex> values;
+                        std::span<const Complex> values;
                         EXPECT_NO_THROW(values = parser->PeekValues(parsed_count));
                         EXPECT_EQ(values.size(), parsed_count);
                         EXPECT_NO_THROW(parser->RemoveValues(parsed_count));
@@ -438,6 +440,62 @@ TEST(TestInputParser, ParseBlock)
     }
 }
 
+TEST(TestInputParser, ParseBlockIntoWindow)
+{
+    for (bool is_complex : { false, true }) {
+        for (auto dt : ALL_DATA_TYPES) {
+            auto parser = InputParser::Build(dt, 1.0, is_complex);
+            auto[buf, res] = make_test(dt, is_complex);
+            std::size_t count = buf.size() / parser->GetDataTypeSize();
+
+            /* window too small */
+            ComplexWindow small(count - 1);
+            EXPECT_THROW_MATCH(parser->ParseBlock(buf, small),
+                               std::runtime_error, "output window too small for block");
+
+            /* parse straight into window, bypassing buffered values */
+            ComplexWindow window(count + 10, Complex(-1.0, -1.0));
+            std::size_t parsed_count = 0;
+            EXPECT_NO_THROW(parsed_count = parser->ParseBlock(buf, window));
+            EXPECT_EQ(parsed_count, count);
+            EXPECT_EQ(parser->GetBufferedValueCount(), 0);
+
+            /* must match buffered parsing, and leave the rest of the window untouched */
+            EXPECT_EQ(parser->ParseBlock(buf), count);
+            auto buffered = parser->PeekValues(count);
+            for (std::size_t i = 0; i < count; i++) {
+                EXPECT_EQ(window[i], buffered[i]);
+            }
+            for (std::size_t i = count; i < window.size(); i++) {
+                EXPECT_EQ(window[i], Complex(-1.0, -1.0));
+            }
+        }
+    }
+}
+
+TEST(TestInputParser, SinglePrecision)
+{
+    for (bool is_complex : { false, true }) {
+        for (auto dt : ALL_DATA_TYPES) {
+            auto parser_double = BasicInputParser<double>::Build(dt, 3.1, is_complex);
+            auto parser_float = BasicInputParser<float>::Build(dt, 3.1, is_complex);
+            auto[buf, res] = make_test(dt, is_complex);
+
+            std::size_t count = buf.size() / parser_double->GetDataTypeSize();
+            EXPECT_EQ(parser_double->ParseBlock(buf), count);
+            EXPECT_EQ(parser_float->ParseBlock(buf), count);
+
+            /* single precision values are the double precision ones, rounded */
+            auto values_double = parser_double->PeekValues(count);
+            auto values_float = parser_float->PeekValues(count);
+            ASSERT_EQ(values_float.size(), count);
+            for (std::size_t i = 0; i < count; i++) {
+                EXPECT_EQ(values_float[i], std::complex<float>(values_double[i]));
+            }
+        }
+    }
+}
+
 TEST(TestInputParser, PeekValues)
 {
     constexpr std::size_t memory = 1024;
@@ -448,7 +506,7 @@ TEST(TestInputParser, PeekValues)
             std::size_t parsed_count = 0;
             EXPECT_NO_THROW(parsed_count = parser->ParseBlock(block));
             for (std::size_t i = 0; i < parsed_count + 100; i ++) {
-                std::vector<Complex> result;
+                std::span<const Complex> result;
                 EXPECT_NO_THROW(result = parser->PeekValues(i));
                 EXPECT_TRUE((result.size() == i) || (result.size() == memory / parser->GetDataTypeSize()));
             }
@@ -467,7 +525,7 @@ TEST(TestInputParser, RemoveValues)
                 std::size_t parsed_count = 0;
                 EXPECT_NO_THROW(parsed_count = parser->ParseBlock(block));
 
-                std::vector<Complex> result;
+                std::span<const Complex> result;
                 EXPECT_NO_THROW(parser->RemoveValues(i));
                 EXPECT_NO_THROW(result = parser->PeekValues(1000000));
                 EXPECT_EQ(result.size(), std::max<int64_t>(parsed_count - i, 0));
@@ -475,3 +533,43 @@ TEST(TestInputParser, RemoveValues)
         }
     }
 }
+
+TEST(TestInputParser, OverlappingWindows)
+{
+    /* consume like the main loop does, with windows overlapping by various amounts; this wraps the ring
+     * around and grows it several times */
+    constexpr std::size_t total = 100000;
+    using Shape = std::pair<std::size_t, std::size_t>;
+    for (auto [width, stride] : { Shape(64, 64), Shape(256, 1), Shape(1000, 333), Shape(17, 100), Shape(4096, 256) }) {
+        auto parser = InputParser::Build(DataType::kFloat64, 1.0, false);
+
+        std::vector<double> input(total);
+        for (std::size_t i = 0; i < total; i++) {
+            input[i] = (double)i;
+        }
+
+        std::size_t parsed = 0;
+        std::size_t removed = 0;
+        std::size_t block = 1;
+        while (parsed < total) {
+            /* vary block size between 1 and 1500 values */
+            block = (block * 7 + 3) % 1500 + 1;
+            std::size_t count = std::min(block, total - parsed);
+            std::span<const char> bytes(reinterpret_cast<const char *>(input.data() + parsed),
+                                        count * sizeof(double));
+            EXPECT_EQ(parser->ParseBlock(bytes), count);
+            parsed += count;
+
+            while (parser->GetBufferedValueCount() >= std::max<std::size_t>(width, stride)) {
+                auto window = parser->PeekValues(width);
+                ASSERT_EQ(window.size(), width);
+                for (std::size_t i = 0; i < width; i++) {
+                    ASSERT_EQ(window[i], Complex((double)(removed + i), 0.0));
+                }
+                parser->RemoveValues(stride);
+                removed += stride;
+            }
+            EXPECT_EQ(parser->GetBufferedValueCount(), parsed - removed);
+        }
+    }
+}
@@ -11,6 +11,8 @@
 #include <string>
 #include <thread>
 #include <csignal>
+#include <sys/stat.h>
+#include <unistd.h>
 
 std::vector<char> random_data(std::size_t size)
 {
@@ -58,6 +60,22 @@ TEST(TestInputReader, BadParameters)
                        std::runtime_error, "block size in bytes must be positive");
     EXPECT_THROW_MATCH(AsyncInputReader((std::istream *)1, 0),
                        std::runtime_error, "block size in bytes must be positive");
+    EXPECT_THROW_MATCH(AsyncInputReader((std::istream *)1, 100, 0),
+                       std::runtime_error, "queue depth must be positive");
+    EXPECT_THROW_MATCH(MmapInputReader("/dev/shm/TestInputReader_BadParameters.data", 0),
+                       std::runtime_error, "block size in bytes must be positive");
+
+    EXPECT_THROW_MATCH(MmapInputReader("/dev/shm/TestInputReader_BadParameters.data", 100),
+                       std::runtime_error, "cannot open input file /dev/shm/TestInputReader_BadParameters.data");
+    EXPECT_THROW_MATCH(MmapInputReader("/dev/shm", 100),
+                       std::runtime_error, "input file /dev/shm is not a regular file");
+
+    /* named pipes are rejected without being opened, which would block until a writer shows up */
+    unlink("/dev/shm/TestInputReader_BadParameters.fifo");
+    ASSERT_EQ(mkfifo("/dev/shm/TestInputReader_BadParameters.fifo", 0600), 0);
+    EXPECT_THROW_MATCH(MmapInputReader("/dev/shm/TestInputReader_BadParameters.fifo", 100),
+                       std::runtime_error, "input file /dev/shm/TestInputReader_BadParameters.fifo is not a regular file");
+    unlink("/dev/shm/TestInputReader_BadParameters.fifo");
 }
 
 TEST(TestInputReader, SyncInputReader)
@@ -91,6 +109,42 @@ TEST(TestInputReader, SyncInputReader)
     }
 }
 
+TEST(TestInputReader, MmapInputReader)
+{
+    constexpr std::size_t max_block_size = 4096;
+    constexpr std::size_t memory = 4096;
+    const std::string file_name = "/dev/shm/TestInputReader_MmapInputReader.data";
+
+    auto expected = random_data(memory);
+    generate_file(file_name, expected);
+
+    for (std::size_t block_size = 1; block_size < max_block_size; block_size++) {
+        MmapInputReader reader(file_name, block_size);
+        EXPECT_EQ(reader.GetBlockCount(), memory / block_size);
+        EXPECT_EQ(reader.GetData().size(), memory);
+
+        std::vector<char> output;
+        output.reserve(memory);
+        while (!reader.ReachedEOF()) {
+            auto block = reader.GetBlock();
+            EXPECT_TRUE(block.has_value());
+            EXPECT_EQ((*block).size(), block_size);
+            output.insert(output.end(), (*block).begin(), (*block).end());
+        }
+        EXPECT_FALSE(reader.GetBlock().has_value());
+
+        check_same(expected, output, block_size);
+    }
+
+    { /* empty files are valid, but yield nothing */
+        generate_file(file_name, {});
+        MmapInputReader reader(file_name, 16);
+        EXPECT_EQ(reader.GetBlockCount(), 0);
+        EXPECT_TRUE(reader.ReachedEOF());
+        EXPECT_FALSE(reader.GetBlock().has_value());
+    }
+}
+
 TEST(TestInputReader, AsyncInputReader)
 {
     constexpr std::size_t max_block_size = 4096;
@@ -109,15 +163,22 @@ TEST(TestInputReader, AsyncInputReader)
 
         std::signal(SIGINT, [](int) {  }); /* SIGINT is sent to the reader thread upon destruction of AsyncInputReader */
         { /* scope out the reader so it does not die when we close the file */
-            AsyncInputReader reader(&file, block_size);
+            /* a shallow queue fills up quickly, so the reader also has to wait for the consumer */
+            const std::size_t queue_depth = 2 + block_size % 3;
+            AsyncInputReader reader(&file, block_size, queue_depth);
             while (output.size() < expected.size() - block_size) {
                 auto block = reader.GetBlock();
                 if (block.has_value()) {
                     EXPECT_EQ((*block).size(), block_size);
                     output.insert(output.end(), (*block).begin(), (*block).end());
+                } else {
+                    /* let the reader thread run, instead of spinning until preempted */
+                    std::this_thread::yield();
                 }
             }
             EXPECT_FALSE(reader.ReachedEOF());
+            EXPECT_EQ(reader.GetQueueDepth(), queue_depth);
+            EXPECT_LE(reader.GetHighWaterMark(), queue_depth);
         }
         std::signal(SIGINT, nullptr);
 
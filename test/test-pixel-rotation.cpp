@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/pixel-rotation.hpp"
+
+#include <numeric>
+#include <vector>
+
+TEST(TestPixelRotation, Errors)
+{
+    std::vector<uint32_t> input(6), output(6);
+    EXPECT_THROW_MATCH(RotatePixels(input, 2, 2, output, 2),
+                       std::runtime_error, "input size does not match image dimensions");
+    EXPECT_THROW_MATCH(RotatePixels(input, 2, 3, output, 2),
+                       std::runtime_error, "output stride is smaller than rotated row");
+    EXPECT_THROW_MATCH(RotatePixels(input, 2, 3, output, 4),
+                       std::runtime_error, "output too small for rotated image");
+}
+
+TEST(TestPixelRotation, Rotation)
+{
+    /* 2x3 image: first row is 0 1, output is its left column last */
+    std::vector<uint32_t> input { 0, 1,
+                                  2, 3,
+                                  4, 5 };
+    std::vector<uint32_t> output(6);
+    RotatePixels(input, 2, 3, output, 3);
+    EXPECT_EQ(output, std::vector<uint32_t>({ 1, 3, 5,
+                                              0, 2, 4 }));
+}
+
+TEST(TestPixelRotation, Kernels)
+{
+    /* sizes cover single pixels, partial blocks and partial tiles */
+    using Size = struct { std::size_t w; std::size_t h; };
+    std::vector<Size> sizes { {1, 1}, {1, 9}, {9, 1}, {4, 4}, {8, 8}, {13, 7}, {16, 96}, {64, 64}, {67, 131} };
+
+    for (auto& size : sizes) {
+        std::vector<uint32_t> input(size.w * size.h);
+        std::iota(input.begin(), input.end(), 0x01000000);
+
+        /* write into the middle of a larger image, leaving 3 pixels between rows untouched */
+        const std::size_t stride = size.h + 3;
+        const uint32_t canary = 0xdeadbeef;
+        std::vector<uint32_t> expected(size.w * stride, canary);
+        for (std::size_t y = 0; y < size.h; y++) {
+            for (std::size_t x = 0; x < size.w; x++) {
+                expected[(size.w - 1 - x) * stride + y] = input[y * size.w + x];
+            }
+        }
+
+        for (auto level : { SimdLevel::kNone, SimdLevel::kSSE2, SimdLevel::kAVX2 }) {
+            std::vector<uint32_t> output(size.w * stride, canary);
+            RotatePixels(input, size.w, size.h, output, stride, level);
+            EXPECT_EQ(output, expected) << size.w << "x" << size.h << " level " << (int)level;
+        }
+    }
+}
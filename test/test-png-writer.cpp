@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/png-writer.hpp"
+
+#include <SFML/Graphics.hpp>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+static uint32_t
+get_uint32(const std::string& data, std::size_t offset)
+{
+    auto p = reinterpret_cast<const uint8_t *>(data.data()) + offset;
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+TEST(TestPngWriter, Errors)
+{
+    std::stringstream ss;
+    EXPECT_THROW_MATCH(PngWriter(ss, 0, 1), std::runtime_error, "PNG image dimensions must be positive");
+    EXPECT_THROW_MATCH(PngWriter(ss, 1, 0), std::runtime_error, "PNG image dimensions must be positive");
+    EXPECT_THROW_MATCH(PngWriter(ss, 0x80000000, 1), std::runtime_error, "PNG image dimensions are too large");
+    EXPECT_THROW_MATCH(PngWriter(ss, 1, 1, -1), std::runtime_error, "PNG compression level must be between 0 and 9");
+    EXPECT_THROW_MATCH(PngWriter(ss, 1, 1, 10), std::runtime_error, "PNG compression level must be between 0 and 9");
+
+    PngWriter png(ss, 2, 2);
+    std::vector<uint8_t> row(8, 0);
+    EXPECT_THROW_MATCH(png.WriteRows(std::span(row).first(7)), std::runtime_error, "PNG pixel data must hold whole rows");
+    EXPECT_THROW_MATCH(png.Finish(), std::runtime_error, "PNG image is incomplete");
+
+    png.WriteRows(row);
+    EXPECT_EQ(png.GetRowsWritten(), 1);
+    std::vector<uint8_t> two_rows(16, 0);
+    EXPECT_THROW_MATCH(png.WriteRows(two_rows), std::runtime_error, "too many rows for PNG image");
+
+    png.WriteRows(row);
+    png.Finish();
+    EXPECT_THROW_MATCH(png.Finish(), std::runtime_error, "PNG image already finished");
+    EXPECT_THROW_MATCH(png.WriteRows(row), std::runtime_error, "too many rows for PNG image");
+}
+
+TEST(TestPngWriter, RoundTrip)
+{
+    constexpr std::size_t width = 301;
+    constexpr std::size_t height = 97;
+
+    /* mix of noise (incompressible, so several IDAT chunks are written) and gradients (exercising filters) */
+    std::vector<uint8_t> pixels(width * height * 4);
+    std::mt19937 generator(42);
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width * 4; x++) {
+            pixels[y * width * 4 + x] = (y % 3 != 0) ? (generator() & 0xff) : ((x * 7 + y * 3) & 0xff);
+        }
+    }
+
+    /* write in uneven strips */
+    std::stringstream ss;
+    PngWriter png(ss, width, height);
+    EXPECT_EQ(png.GetWidth(), width);
+    EXPECT_EQ(png.GetHeight(), height);
+    std::span<const uint8_t> all(pixels);
+    png.WriteRows(all.first(width * 4));
+    png.WriteRows(all.subspan(width * 4, width * 4 * 10));
+    png.WriteRows(all.subspan(width * 4 * 11));
+    png.Finish();
+    auto data = ss.str();
+
+    /* check signature and chunk structure */
+    ASSERT_GT(data.size(), 8);
+    EXPECT_EQ(std::memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8), 0);
+    std::vector<std::string> types;
+    std::size_t offset = 8;
+    while (offset + 12 <= data.size()) {
+        auto length = get_uint32(data, offset);
+        ASSERT_LE(offset + 12 + length, data.size());
+        auto type = data.substr(offset + 4, 4);
+        uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(data.data()) + offset + 4, length + 4);
+        EXPECT_EQ(get_uint32(data, offset + 8 + length), crc) << "bad CRC on " << type;
+        if (type == "IHDR") {
+            EXPECT_EQ(get_uint32(data, offset + 8), width);
+            EXPECT_EQ(get_uint32(data, offset + 12), height);
+        }
+        types.push_back(type);
+        offset += 12 + length;
+    }
+    EXPECT_EQ(offset, data.size());
+    ASSERT_GE(types.size(), 4);
+    EXPECT_EQ(types.front(), "IHDR");
+    EXPECT_EQ(types.back(), "IEND");
+    for (std::size_t i = 1; i < types.size() - 1; i++) {
+        EXPECT_EQ(types[i], "IDAT");
+    }
+
+    /* decode */
+    sf::Image image;
+    ASSERT_TRUE(image.loadFromMemory(data.data(), data.size()));
+    ASSERT_EQ(image.getSize().x, width);
+    ASSERT_EQ(image.getSize().y, height);
+    EXPECT_EQ(std::memcmp(image.getPixelsPtr(), pixels.data(), pixels.size()), 0);
+}
+
+TEST(TestPngWriter, CompressionLevels)
+{
+    constexpr std::size_t width = 64;
+    constexpr std::size_t height = 64;
+
+    /* smooth content, compressible */
+    std::vector<uint8_t> pixels(width * height * 4);
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            uint8_t *p = pixels.data() + (y * width + x) * 4;
+            p[0] = x * 4;
+            p[1] = y * 4;
+            p[2] = (x + y) * 2;
+            p[3] = 255;
+        }
+    }
+
+    std::vector<std::size_t> sizes;
+    for (int level : { 0, 1, 3, 4, 9 }) {
+        std::stringstream ss;
+        PngWriter png(ss, width, height, level);
+        png.WriteRows(pixels);
+        png.Finish();
+        auto data = ss.str();
+        sizes.push_back(data.size());
+
+        sf::Image image;
+        ASSERT_TRUE(image.loadFromMemory(data.data(), data.size())) << "level " << level;
+        ASSERT_EQ(image.getSize().x, width);
+        ASSERT_EQ(image.getSize().y, height);
+        EXPECT_EQ(std::memcmp(image.getPixelsPtr(), pixels.data(), pixels.size()), 0) << "level " << level;
+    }
+
+    /* no compression stores filter bytes and pixels as they are */
+    EXPECT_GT(sizes[0], height * (width * 4 + 1));
+    EXPECT_LT(sizes[1], sizes[0]);
+    EXPECT_LE(sizes[4], sizes[1]);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/raster.hpp"
+#include "../src/share-tech-mono.hpp"
+
+#include <vector>
+
+static std::vector<uint8_t>
+pixel(const std::vector<uint8_t>& pixels, std::size_t width, std::size_t x, std::size_t y)
+{
+    auto p = pixels.begin() + (y * width + x) * 4;
+    return std::vector<uint8_t>(p, p + 4);
+}
+
+TEST(TestRaster, Errors)
+{
+    std::vector<uint8_t> pixels(4 * 4 * 4);
+    EXPECT_THROW_MATCH(Raster(pixels, 0, 0, 4, 3),
+                       std::runtime_error, "raster buffer size does not match raster dimensions");
+
+    Raster raster(pixels, 0, 0, 4, 4);
+    std::vector<uint8_t> image(3 * 4);
+    EXPECT_THROW_MATCH(raster.DrawImage(sf::Transform(), 2, 2, image),
+                       std::runtime_error, "image size does not match image dimensions");
+    EXPECT_THROW_MATCH(raster.DrawMask(sf::Transform(), 2, 2, image, sf::Color::White),
+                       std::runtime_error, "mask size does not match mask dimensions");
+
+    EXPECT_THROW_MATCH(RasterFont(std::span<const uint8_t>(ShareTechMono_Regular_ttf, 16), 12),
+                       std::runtime_error, "unable to load font");
+}
+
+TEST(TestRaster, FillRect)
+{
+    /* window of a canvas, starting at (10, 20) */
+    std::vector<uint8_t> pixels(4 * 3 * 4);
+    Raster raster(pixels, 10, 20, 4, 3);
+    raster.Clear(sf::Color(1, 2, 3, 4));
+    EXPECT_EQ(pixel(pixels, 4, 3, 2), std::vector<uint8_t>({ 1, 2, 3, 4 }));
+
+    /* covers pixels whose centers it covers, clipped to window */
+    raster.FillRect(sf::Transform().translate(8.0f, 19.0f), sf::FloatRect(0.0f, 0.0f, 3.4f, 1.6f),
+                    sf::Color(255, 0, 0));
+    EXPECT_EQ(pixel(pixels, 4, 0, 0), std::vector<uint8_t>({ 255, 0, 0, 255 }));
+    EXPECT_EQ(pixel(pixels, 4, 1, 0), std::vector<uint8_t>({ 1, 2, 3, 4 }));
+    EXPECT_EQ(pixel(pixels, 4, 0, 1), std::vector<uint8_t>({ 1, 2, 3, 4 }));
+
+    /* negative sizes extend up and left */
+    raster.FillRect(sf::Transform().translate(14.0f, 23.0f), sf::FloatRect(0.0f, 0.0f, -1.0f, -2.0f),
+                    sf::Color(0, 255, 0));
+    EXPECT_EQ(pixel(pixels, 4, 3, 2), std::vector<uint8_t>({ 0, 255, 0, 255 }));
+    EXPECT_EQ(pixel(pixels, 4, 3, 1), std::vector<uint8_t>({ 0, 255, 0, 255 }));
+    EXPECT_EQ(pixel(pixels, 4, 3, 0), std::vector<uint8_t>({ 1, 2, 3, 4 }));
+    EXPECT_EQ(pixel(pixels, 4, 2, 2), std::vector<uint8_t>({ 1, 2, 3, 4 }));
+
+    /* translucent colors are blended */
+    raster.Clear(sf::Color(0, 0, 0));
+    raster.FillRect(sf::Transform(), sf::FloatRect(10.0f, 20.0f, 1.0f, 1.0f), sf::Color(255, 255, 255, 51));
+    EXPECT_EQ(pixel(pixels, 4, 0, 0), std::vector<uint8_t>({ 51, 51, 51, 255 }));
+}
+
+TEST(TestRaster, DrawImage)
+{
+    std::vector<uint8_t> image { 1, 1, 1, 255,  2, 2, 2, 255,
+                                 3, 3, 3, 255,  4, 4, 4, 255 };
+
+    /* scaled up twice, rotated a quarter turn clockwise */
+    std::vector<uint8_t> pixels(4 * 4 * 4);
+    Raster raster(pixels, 0, 0, 4, 4);
+    raster.DrawImage(sf::Transform().translate(4.0f, 0.0f).rotate(90.0f).scale(2.0f, 2.0f), 2, 2, image);
+
+    std::vector<uint8_t> expected { 3, 3, 1, 1,
+                                    3, 3, 1, 1,
+                                    4, 4, 2, 2,
+                                    4, 4, 2, 2 };
+    for (std::size_t y = 0; y < 4; y++) {
+        for (std::size_t x = 0; x < 4; x++) {
+            EXPECT_EQ(pixels[(y * 4 + x) * 4], expected[y * 4 + x]) << x << "," << y;
+        }
+    }
+}
+
+TEST(TestRaster, Text)
+{
+    RasterFont font(std::span<const uint8_t>(ShareTechMono_Regular_ttf, ShareTechMono_Regular_ttf_len), 12);
+
+    EXPECT_EQ(font.GetTextBounds("").width, 0.0f);
+    auto bounds = font.GetTextBounds("-120dBFS");
+    auto short_bounds = font.GetTextBounds("0dB");
+    EXPECT_GT(bounds.width, short_bounds.width);
+    EXPECT_GT(bounds.height, 0.0f);
+    EXPECT_LE(bounds.top + bounds.height, 12.0f + 12.0f / 2.0f);
+
+    /* all text falls within its bounds */
+    const std::size_t width = 100, height = 20;
+    std::vector<uint8_t> pixels(width * height * 4);
+    Raster raster(pixels, 0, 0, width, height);
+    raster.Clear(sf::Color::Transparent);
+    font.DrawText(raster, "-120dBFS", sf::Transform(), sf::Color::White);
+
+    std::size_t drawn = 0;
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            if (pixels[(y * width + x) * 4 + 3] > 0) {
+                drawn++;
+                EXPECT_GE(x, bounds.left);
+                EXPECT_LT(x, bounds.left + bounds.width);
+                EXPECT_GE(y, bounds.top);
+                EXPECT_LT(y, bounds.top + bounds.height);
+            }
+        }
+    }
+    EXPECT_GT(drawn, 0);
+
+    /* half a turn mirrors text through the center of the raster */
+    std::vector<uint8_t> rotated(width * height * 4);
+    Raster rotated_raster(rotated, 0, 0, width, height);
+    rotated_raster.Clear(sf::Color::Transparent);
+    font.DrawText(rotated_raster, "-120dBFS", sf::Transform().translate(width, height).rotate(180.0f),
+                  sf::Color::White);
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            EXPECT_EQ(pixel(rotated, width, width - 1 - x, height - 1 - y), pixel(pixels, width, x, y));
+        }
+    }
+}
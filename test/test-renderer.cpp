@@ -6,7 +6,9 @@
  */
 #include "test.hpp"
 #include "../src/renderer.hpp"
-#include <X11/Xlib.h>
+
+#include <cstring>
+#include <random>
 
 class ExposedRenderer : public Renderer
 {
@@ -34,6 +36,22 @@ public:
     }
 };
 
+static std::vector<std::vector<double>>
+random_windows(std::size_t width, std::size_t count)
+{
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::uniform_real_distribution<double> ud(0.0, 1.0);
+
+    std::vector<std::vector<double>> windows(count, std::vector<double>(width));
+    for (auto& window : windows) {
+        for (auto& v : window) {
+            v = ud(re);
+        }
+    }
+    return windows;
+}
+
 TEST(TestRenderer, ValueToShortString)
 {
     /* unit prefix */
@@ -130,15 +148,6 @@ TEST(TestRenderer, GetLinearTicks)
 
 TEST(TestRenderer, GetNiceTicks)
 {
-    { /* skip if Xorg not started */
-        auto display = XOpenDisplay(nullptr);
-        if (display == nullptr) {
-            GTEST_SKIP();
-        } else {
-            XCloseDisplay(display);
-        }
-    }
-
     constexpr double epsilon = 1e-9;
 
     /* configuration */
@@ -195,3 +204,128 @@ TEST(TestRenderer, GetNiceTicks)
         }
     }
 }
+
+TEST(TestRenderer, RenderStrips)
+{
+    /* enough windows for several strips, and a width that does not split evenly in bands */
+    constexpr std::size_t width = 40;
+    constexpr std::size_t fft_count = 2 * Renderer::STRIP_SIZE + 89;
+
+    History history(width, 64);
+    for (const auto& window : random_windows(width, fft_count)) {
+        history.AddRow(window);
+    }
+
+    auto render_strips = [&](const Configuration& conf) {
+        Renderer renderer(conf, fft_count);
+        std::vector<uint8_t> output;
+        renderer.RenderStrips(history, [&](std::span<const uint8_t> pixels) {
+            EXPECT_EQ(pixels.size() % (renderer.GetOutputWidth() * 4), 0);
+            output.insert(output.end(), pixels.begin(), pixels.end());
+        });
+        EXPECT_EQ(output.size(), renderer.GetOutputWidth() * renderer.GetOutputHeight() * 4);
+        return output;
+    };
+
+    /* without UI, canvas pixel (x, y) is the color of value x in window y; horizontal output row r holds canvas
+     * column (width-1-r), top to bottom */
+    for (bool horizontal : { false, true }) {
+        const char *args[] { "program", "out.png", "-w", "40", "-z" };
+        auto[conf, rc, exit] = Configuration::Build(horizontal ? 5 : 4, args);
+        EXPECT_EQ(rc, 0);
+        EXPECT_FALSE(exit);
+        EXPECT_EQ(conf.IsHorizontal(), horizontal);
+
+        auto color_map = ColorMap::Build(conf.GetColorMap(), conf.GetBackgroundColor(),
+                                         conf.GetColorMapCustomColor());
+        std::vector<uint8_t> reference(width * fft_count * 4);
+        for (std::size_t y = 0; y < fft_count; y++) {
+            for (std::size_t x = 0; x < width; x++) {
+                std::size_t index = horizontal ? ((width - 1 - x) * fft_count + y) : (y * width + x);
+                color_map->Map(history.GetRow(y).subspan(x, 1),
+                               std::span<uint8_t>(reference).subspan(index * 4, 4));
+            }
+        }
+
+        auto output = render_strips(conf);
+        EXPECT_TRUE(output == reference) << (horizontal ? "horizontal" : "vertical");
+    }
+
+    /* with axes and legend the strips must match a single tile over the whole canvas, rotated pixel by pixel */
+    for (bool horizontal : { false, true }) {
+        const char *args[] { "program", "out.png", "-w", "40", "-e", "-z" };
+        auto[conf, rc, exit] = Configuration::Build(horizontal ? 6 : 5, args);
+        EXPECT_EQ(rc, 0);
+        EXPECT_FALSE(exit);
+
+        Renderer renderer(conf, fft_count);
+        std::size_t canvas_width = horizontal ? renderer.GetOutputHeight() : renderer.GetOutputWidth();
+        std::size_t canvas_height = horizontal ? renderer.GetOutputWidth() : renderer.GetOutputHeight();
+        EXPECT_GT(canvas_height, Renderer::STRIP_SIZE);
+        std::vector<uint8_t> canvas(canvas_width * canvas_height * 4);
+        renderer.RenderTile(history, 0, 0, canvas_width, canvas_height, canvas);
+
+        std::vector<uint8_t> reference(canvas.size());
+        for (std::size_t y = 0; y < canvas_height; y++) {
+            for (std::size_t x = 0; x < canvas_width; x++) {
+                std::size_t index = horizontal ? ((canvas_width - 1 - x) * canvas_height + y) : (y * canvas_width + x);
+                std::memcpy(&reference[index * 4], &canvas[(y * canvas_width + x) * 4], 4);
+            }
+        }
+
+        auto output = render_strips(conf);
+        EXPECT_TRUE(output == reference) << (horizontal ? "horizontal" : "vertical");
+    }
+}
+
+TEST(TestRenderer, StripStream)
+{
+    constexpr std::size_t width = 40;
+    constexpr std::size_t fft_count = 2 * Renderer::STRIP_SIZE + 89;
+    auto windows = random_windows(width, fft_count);
+
+    const char *args[] { "program", "out.png", "-w", "40", "-e", "-z" };
+    auto[conf, rc, exit] = Configuration::Build(5, args);
+    EXPECT_EQ(rc, 0);
+    EXPECT_FALSE(exit);
+    auto[hconf, hrc, hexit] = Configuration::Build(6, args);
+    EXPECT_EQ(hrc, 0);
+    EXPECT_FALSE(hexit);
+
+    Renderer horizontal_renderer(hconf, fft_count);
+    EXPECT_THROW_MATCH(StripStream(horizontal_renderer, [](std::span<const uint8_t>) { }),
+                       std::runtime_error, "horizontal output cannot be streamed");
+
+    /* streamed output matches the output rendered at once, including blank windows if some are missing at the end;
+     * strips are handed out as soon as their windows are known */
+    Renderer renderer(conf, fft_count);
+    for (std::size_t count : { fft_count, fft_count - 1, Renderer::STRIP_SIZE + 3, (std::size_t) 0 }) {
+        History history(width);
+        std::vector<uint8_t> reference;
+        for (std::size_t i = 0; i < count; i++) {
+            history.AddRow(windows[i]);
+        }
+        renderer.RenderStrips(history, [&](std::span<const uint8_t> pixels) {
+            reference.insert(reference.end(), pixels.begin(), pixels.end());
+        });
+
+        std::vector<uint8_t> output;
+        StripStream stream(renderer, [&](std::span<const uint8_t> pixels) {
+            output.insert(output.end(), pixels.begin(), pixels.end());
+        });
+        for (std::size_t i = 0; i < count; i++) {
+            stream.AddRow(windows[i]);
+            auto [first, last] = renderer.GetVisibleWindows(0, output.size() / (renderer.GetOutputWidth() * 4));
+            EXPECT_LE(last, i + 1);
+        }
+        EXPECT_EQ(stream.GetRowCount(), count);
+        if (count == fft_count) {
+            /* nothing left for Finish() */
+            EXPECT_EQ(output.size(), reference.size());
+            EXPECT_THROW_MATCH(stream.AddRow(windows[0]),
+                               std::runtime_error, "more windows than the renderer was created for");
+        }
+        stream.Finish();
+        EXPECT_TRUE(output == reference) << count << " windows";
+    }
+}
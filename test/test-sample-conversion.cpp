@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/sample-conversion.hpp"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+template <class T>
+static std::vector<T>
+make_samples(std::size_t count)
+{
+    std::random_device rd;
+    std::default_random_engine re(rd());
+    std::vector<T> samples(count);
+
+    if constexpr (std::is_floating_point_v<T>) {
+        std::uniform_real_distribution<T> ud(-1.0, 1.0);
+        for (auto& s : samples) {
+            s = ud(re);
+        }
+        /* sprinkle some NaNs */
+        for (std::size_t i = 3; i < count; i += 7) {
+            samples[i] = std::numeric_limits<T>::quiet_NaN();
+        }
+    } else {
+        std::uniform_int_distribution<int64_t> ud(std::numeric_limits<int64_t>::min(),
+                                                  std::numeric_limits<int64_t>::max());
+        for (auto& s : samples) {
+            s = static_cast<T>(ud(re));
+        }
+        /* make sure limits are covered */
+        if (count >= 2) {
+            samples[0] = std::numeric_limits<T>::min();
+            samples[1] = std::numeric_limits<T>::max();
+        }
+    }
+    return samples;
+}
+
+template <class T, class O>
+static void
+test_conversion()
+{
+    constexpr double scale = 0.73;
+    for (auto level : { SimdLevel::kNone, SimdLevel::kSSE2, SimdLevel::kAVX2 }) {
+        for (bool is_complex : { false, true }) {
+            /* lengths that exercise the vector kernels as well as their tails */
+            for (std::size_t count = 0; count < 70; count += (is_complex ? 2 : 1)) {
+                auto samples = make_samples<T>(count);
+                std::vector<std::complex<O>> output(count + 1, std::complex<O>(-5.0, -5.0));
+                ConvertSamples<T, O>(samples, is_complex, scale, output, level);
+
+                for (std::size_t i = 0; i < count; i++) {
+                    O expected = std::isnan((double)samples[i]) ? 0.0 : static_cast<O>((double)samples[i] * scale);
+                    O actual = is_complex ? reinterpret_cast<O *>(output.data())[i] : output[i].real();
+                    EXPECT_EQ(actual, expected);
+                    if (!is_complex) {
+                        EXPECT_EQ(output[i].imag(), 0.0);
+                    }
+                }
+
+                /* nothing written past the converted values */
+                EXPECT_EQ(output[is_complex ? count / 2 : count], std::complex<O>(-5.0, -5.0));
+            }
+        }
+    }
+}
+
+TEST(TestSampleConversion, SupportedLevel)
+{
+#if defined(__x86_64__)
+    EXPECT_GE(GetSupportedSimdLevel(), SimdLevel::kSSE2);
+#else
+    EXPECT_EQ(GetSupportedSimdLevel(), SimdLevel::kNone);
+#endif
+}
+
+TEST(TestSampleConversion, SignedInteger)
+{
+    test_conversion<int8_t, float>();
+    test_conversion<int8_t, double>();
+    test_conversion<int16_t, float>();
+    test_conversion<int16_t, double>();
+    test_conversion<int32_t, float>();
+    test_conversion<int32_t, double>();
+    test_conversion<int64_t, float>();
+    test_conversion<int64_t, double>();
+}
+
+TEST(TestSampleConversion, UnsignedInteger)
+{
+    test_conversion<uint8_t, float>();
+    test_conversion<uint8_t, double>();
+    test_conversion<uint16_t, float>();
+    test_conversion<uint16_t, double>();
+    test_conversion<uint32_t, float>();
+    test_conversion<uint32_t, double>();
+    test_conversion<uint64_t, float>();
+    test_conversion<uint64_t, double>();
+}
+
+TEST(TestSampleConversion, FloatingPoint)
+{
+    test_conversion<float, float>();
+    test_conversion<float, double>();
+    test_conversion<double, float>();
+    test_conversion<double, double>();
+}
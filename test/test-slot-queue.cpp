@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2020-2023 Vasile Vilvoiu <vasi@vilvoiu.ro>
+ *
+ * specgram is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include "test.hpp"
+#include "../src/slot-queue.hpp"
+#include <thread>
+
+TEST(TestSlotQueue, BadParameters)
+{
+    EXPECT_THROW_MATCH(SlotQueue<char>(0, 1),
+                       std::runtime_error, "slot size must be positive");
+    EXPECT_THROW_MATCH(SlotQueue<char>(1, 0),
+                       std::runtime_error, "queue depth must be positive");
+}
+
+TEST(TestSlotQueue, FillAndDrain)
+{
+    constexpr std::size_t slot_size = 7;
+    constexpr std::size_t depth = 5;
+    SlotQueue<char> queue(slot_size, depth);
+
+    EXPECT_EQ(queue.GetSlotSize(), slot_size);
+    EXPECT_EQ(queue.GetDepth(), depth);
+    EXPECT_EQ(queue.GetSize(), 0);
+    EXPECT_FALSE(queue.Front().has_value());
+
+    for (int round = 0; round < 3; round++) {
+        /* fill */
+        for (std::size_t i = 0; i < depth; i++) {
+            auto slot = queue.AcquireWrite();
+            EXPECT_TRUE(slot.has_value());
+            EXPECT_EQ(slot->size(), slot_size);
+            for (auto& v : *slot) { v = static_cast<char>(i + round); }
+            queue.Push();
+            EXPECT_EQ(queue.GetSize(), i + 1);
+        }
+
+        /* full, retrying counts as a single overrun */
+        EXPECT_FALSE(queue.AcquireWrite().has_value());
+        EXPECT_FALSE(queue.AcquireWrite().has_value());
+        EXPECT_EQ(queue.GetOverrunCount(), round + 1);
+        EXPECT_EQ(queue.GetHighWaterMark(), depth);
+
+        /* drain, in order */
+        for (std::size_t i = 0; i < depth; i++) {
+            auto slot = queue.Front();
+            EXPECT_TRUE(slot.has_value());
+            EXPECT_EQ(slot->size(), slot_size);
+            for (auto v : *slot) { EXPECT_EQ(v, static_cast<char>(i + round)); }
+            queue.Pop();
+        }
+        EXPECT_EQ(queue.GetSize(), 0);
+        EXPECT_FALSE(queue.Front().has_value());
+    }
+}
+
+TEST(TestSlotQueue, ProducerConsumer)
+{
+    constexpr std::size_t slot_size = 3;
+    constexpr std::size_t depth = 4;
+    constexpr std::size_t count = 100000;
+    SlotQueue<char> queue(slot_size, depth);
+
+    std::thread producer([&queue]() {
+        for (std::size_t i = 0; i < count; ) {
+            auto slot = queue.AcquireWrite();
+            if (!slot.has_value()) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (auto& v : *slot) { v = static_cast<char>(i & 0x7f); }
+            queue.Push();
+            i++;
+        }
+    });
+
+    for (std::size_t i = 0; i < count; ) {
+        auto slot = queue.Front();
+        if (!slot.has_value()) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (auto v : *slot) { EXPECT_EQ(v, static_cast<char>(i & 0x7f)); }
+        queue.Pop();
+        i++;
+    }
+    producer.join();
+
+    EXPECT_EQ(queue.GetSize(), 0);
+    EXPECT_LE(queue.GetHighWaterMark(), depth);
+}
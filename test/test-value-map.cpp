@@ -127,3 +127,20 @@ TEST(TestValueMap, LogarithmicMapDomain)
     EXPECT_LE(std::abs(map->Map(RealWindow { 0.0 })[0]), epsilon);
     EXPECT_LE(std::abs(map->Map(RealWindow { 100.0 })[0] - 1.0), epsilon);
 }
+
+TEST(TestValueMap, MapIntoWindow)
+{
+    RealWindow input { 1e-9, 0.001, 0.5, 1.0, 2.0, 50.0 };
+    for (auto type : ALL_VALUE_MAP_TYPES) {
+        auto map = ValueMap::Build(type, -20.0, 20.0, "");
+
+        /* same as the allocating overload */
+        auto expected = map->Map(input);
+        RealWindow output(input.size());
+        map->Map(input, output);
+        EXPECT_EQ(output, expected);
+
+        EXPECT_THROW_MATCH(map->Map(input, std::span<double>(output).first(3)),
+                           std::runtime_error, "output window size must match input size");
+    }
+}